@@ -97,6 +97,7 @@ namespace senjo {
                 params.popNumber("btime", goParams.btime) ||
                 params.popNumber("movetime", goParams.movetime) ||
                 params.popNumber("nodes", goParams.nodes) ||
+                params.popNumber("mate", goParams.mate) ||
                 params.popNumber("winc", goParams.winc) ||
                 params.popNumber("wtime", goParams.wtime)) {
                 continue;
@@ -113,6 +114,12 @@ namespace senjo {
         return true;
     }
 
+//-----------------------------------------------------------------------------
+    bool GoCommandHandle::run() {
+        engine.prepareSearch(goParams);
+        return BackgroundCommand::run();
+    }
+
 //-----------------------------------------------------------------------------
     void GoCommandHandle::doWork() {
         std::string ponderMove;
@@ -122,6 +122,8 @@ namespace senjo {
             engine.stopSearching();
         }
 
+        bool run();
+
     protected:
         bool parse(Parameters &params);
 
@@ -243,6 +243,14 @@ namespace senjo {
         //---------------------------------------------------------------------------
         virtual uint64_t perft(const int16_t depth) = 0;
 
+        //---------------------------------------------------------------------------
+        //! \brief Prepare for a search, before the search thread is started
+        //! Called on the thread that reads the commands, so a "stop" or "ponderhit"
+        //! that follows the "go" command always sees the state set here.
+        //! \param[in] params UCI "go" command parameters
+        //---------------------------------------------------------------------------
+        virtual void prepareSearch(const GoParams &params) = 0;
+
         //---------------------------------------------------------------------------
         //! \brief Execute search on current position to find best move
         //! \param[in] params UCI "go" command parameters
@@ -36,6 +36,7 @@ namespace senjo {
         uint64_t btime = 0; // Milliseconds remaining on black's clock
         uint64_t movetime = 0; // Maximum milliseconds to spend on this move
         uint64_t nodes = 0; // Maximum number of nodes to search
+        int mate = 0; // Search for a mate in this many moves
         uint64_t winc = 0; // WHITE increment per move in milliseconds
         uint64_t wtime = 0; // Milliseconds remaining on white's clock
     };
@@ -35,6 +35,9 @@ namespace senjo {
         uint64_t qnodes = 0; // The number of quiescence nodes searched so far
         uint64_t msecs = 0; // The number of milliseconds spent searching so far
         int score = 0;
+        bool lowerbound = false; // The score is a lower bound, the search failed high
+        bool upperbound = false; // The score is an upper bound, the search failed low
+        int hashfull = 0; // Permill of the hash table that is in use
         std::string pv = "";
     };
 
@@ -43,9 +46,12 @@ namespace senjo {
         os << "info depth " << stats.depth
            << " seldepth " << stats.seldepth
            << " score cp " << stats.score
+           << (stats.lowerbound ? " lowerbound" : "")
+           << (stats.upperbound ? " upperbound" : "")
            << " nodes " << stats.nodes + stats.qnodes
            << " time " << stats.msecs
            << " nps " << static_cast<uint64_t>((stats.nodes + stats.qnodes) / std::max(stats.msecs / 1000.0, 1.0))
+           << " hashfull " << stats.hashfull
            << " pv " << stats.pv;
 
         return os;
@@ -395,7 +395,9 @@ namespace senjo {
             engine.initialize();
         }
 
-        if (lastCommand) {
+        // a search (e.g. pondering or infinite) may only end on stop or
+        // ponderhit, so it is answered right away instead of waiting for it
+        if (lastCommand && !std::dynamic_pointer_cast<GoCommandHandle>(lastCommand)) {
             // don't set stop flag
             lastCommand->waitForFinish();
         }
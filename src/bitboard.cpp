@@ -20,6 +20,7 @@
 
 #include "bitboard.h"
 
+#include <algorithm>
 #include <random>
 
 #include "../senjo/Output.h"
@@ -36,7 +37,15 @@ uint64_t Bitboard::getEmptyBoard() const { return ~occupiedBB; }
 
 PieceColor Bitboard::getMovingColor() const { return movingColor; }
 
-void Bitboard::setMovingColor(PieceColor movingColor) { this->movingColor = movingColor; }
+void Bitboard::setMovingColor(PieceColor movingColor) {
+    // Keep the hash in sync, otherwise the position would share its hash with the same position
+    // with the other side to move
+    if (this->movingColor != movingColor) {
+        zobristHash ^= getMovingColorZobristConstant();
+    }
+
+    this->movingColor = movingColor;
+}
 
 PieceType Bitboard::getPieceOnSquare(int8_t square) {
     return pieceSquareMapping[square];
@@ -51,37 +60,19 @@ uint64_t Bitboard::getQueenAttacks(int8_t square, uint64_t occupancy) {
 }
 
 uint64_t Bitboard::getBishopAttacks(int8_t square) {
-    uint64_t occupancy = getOccupiedBoard();
-    occupancy &= getBishopMask(square);
-    occupancy *= getBishopMagic(square);
-    occupancy >>= 64 - BBits[square];
-
-    return getBishopMagicAttacks(square, occupancy);
+    return getBishopMagicAttacks(square, getBishopAttackIndex(square, getOccupiedBoard()));
 }
 
 uint64_t Bitboard::getBishopAttacks(int8_t square, uint64_t occupancy) {
-    occupancy &= getBishopMask(square);
-    occupancy *= getBishopMagic(square);
-    occupancy >>= 64 - BBits[square];
-
-    return getBishopMagicAttacks(square, occupancy);
+    return getBishopMagicAttacks(square, getBishopAttackIndex(square, occupancy));
 }
 
 uint64_t Bitboard::getRookAttacks(int8_t square) {
-    uint64_t occupancy = getOccupiedBoard();
-    occupancy &= getRookMask(square);
-    occupancy *= getRookMagic(square);
-    occupancy >>= 64 - RBits[square];
-
-    return getRookMagicAttacks(square, occupancy);
+    return getRookMagicAttacks(square, getRookAttackIndex(square, getOccupiedBoard()));
 }
 
 uint64_t Bitboard::getRookAttacks(int8_t square, uint64_t occupancy) {
-    occupancy &= getRookMask(square);
-    occupancy *= getRookMagic(square);
-    occupancy >>= 64 - RBits[square];
-
-    return getRookMagicAttacks(square, occupancy);
+    return getRookMagicAttacks(square, getRookAttackIndex(square, occupancy));
 }
 
 void Bitboard::setPiece(int8_t square, PieceType piece) {
@@ -93,6 +84,14 @@ void Bitboard::setPiece(int8_t square, PieceType piece) {
     materialCount[piece] += 1;
     pstValues[piece % 2] += getMidgamePstValue(piece, square);
     pstValues[piece % 2 + 2] += getEndgamePstValue(piece, square);
+
+    if (piece == WHITE_PAWN || piece == BLACK_PAWN) {
+        pawnHash ^= getPieceZobristConstant(piece, square);
+    }
+
+    if (isNnueEnabled()) {
+        addFeature(accumulator, piece, square);
+    }
 }
 
 void Bitboard::removePiece(int8_t square, PieceType piece) {
@@ -104,13 +103,26 @@ void Bitboard::removePiece(int8_t square, PieceType piece) {
     materialCount[piece] -= 1;
     pstValues[piece % 2] -= getMidgamePstValue(piece, square);
     pstValues[piece % 2 + 2] -= getEndgamePstValue(piece, square);
+
+    if (piece == WHITE_PAWN || piece == BLACK_PAWN) {
+        pawnHash ^= getPieceZobristConstant(piece, square);
+    }
+
+    if (isNnueEnabled()) {
+        removeFeature(accumulator, piece, square);
+    }
 }
 
-void Bitboard::makeMove(Move& move) {
-    PieceType capturedPiece = getPieceOnSquare(move.to);
+void Bitboard::makeMove(Move move) {
+    int8_t from = getFromSquare(move);
+    int8_t to = getToSquare(move);
+    PieceType piece = getPieceOnSquare(from);
+    PieceType promotionPiece = getPromotionPiece(move, movingColor);
+    PieceType capturedPiece = getPieceOnSquare(to);
 
     undoStack[ply].capturedPiece = capturedPiece;
     undoStack[ply].halfMoveClock = halfMoveClock;
+    undoStack[ply].pliesFromNull = pliesFromNull;
     undoStack[ply].enPassantSquare = enPassantSquare;
     undoStack[ply].castlingRights = castlingRights;
     undoStack[ply].moveType = REGULAR;
@@ -118,32 +130,33 @@ void Bitboard::makeMove(Move& move) {
     undoStack[ply].previousMove = previousMove;
 
     halfMoveClock += 1;
+    pliesFromNull += 1;
 
     if (capturedPiece != EMPTY) {
         halfMoveClock = 0;
-        removePiece(move.to, capturedPiece);
+        removePiece(to, capturedPiece);
     }
 
-    if (move.piece == WHITE_PAWN || move.piece == BLACK_PAWN) {
+    if (piece == WHITE_PAWN || piece == BLACK_PAWN) {
         halfMoveClock = 0;
     }
 
-    removePiece(move.from, move.piece);
+    removePiece(from, piece);
 
     if (enPassantSquare != NO_SQUARE) {
         zobristHash ^= getEnPassantZobristConstant(enPassantSquare % 8);
     }
 
-    if (move.piece == WHITE_PAWN || move.piece == BLACK_PAWN) {
+    if (piece == WHITE_PAWN || piece == BLACK_PAWN) {
         halfMoveClock = 0;
 
-        if (move.to - move.from == 16) {
-            enPassantSquare = move.to - 8;
-        } else if (move.to - move.from == -16) {
-            enPassantSquare = move.to + 8;
-        } else if ((std::abs(move.to - move.from) == 7 || std::abs(move.to - move.from) == 9) &&
-                   move.to == enPassantSquare) {
-            int8_t enPassantCaptureSquare = move.to - (movingColor == WHITE ? 8 : -8);
+        if (to - from == 16) {
+            enPassantSquare = to - 8;
+        } else if (to - from == -16) {
+            enPassantSquare = to + 8;
+        } else if ((std::abs(to - from) == 7 || std::abs(to - from) == 9) &&
+                   to == enPassantSquare) {
+            int8_t enPassantCaptureSquare = to - (movingColor == WHITE ? 8 : -8);
             removePiece(enPassantCaptureSquare, getPieceOnSquare(enPassantCaptureSquare));
             undoStack[ply].moveType = EN_PASSANT;
             enPassantSquare = NO_SQUARE;
@@ -158,18 +171,18 @@ void Bitboard::makeMove(Move& move) {
         zobristHash ^= getEnPassantZobristConstant(enPassantSquare % 8);
     }
 
-    if (move.piece == WHITE_KING || move.piece == BLACK_KING) {
-        if (std::abs(move.to - move.from) == 2) {
-            if (move.to == G1) {
+    if (piece == WHITE_KING || piece == BLACK_KING) {
+        if (std::abs(to - from) == 2) {
+            if (to == G1) {
                 removePiece(H1, WHITE_ROOK);
                 setPiece(F1, WHITE_ROOK);
-            } else if (move.to == C1) {
+            } else if (to == C1) {
                 removePiece(A1, WHITE_ROOK);
                 setPiece(D1, WHITE_ROOK);
-            } else if (move.to == G8) {
+            } else if (to == G8) {
                 removePiece(H8, BLACK_ROOK);
                 setPiece(F8, BLACK_ROOK);
-            } else if (move.to == C8) {
+            } else if (to == C8) {
                 removePiece(A8, BLACK_ROOK);
                 setPiece(D8, BLACK_ROOK);
             }
@@ -177,7 +190,7 @@ void Bitboard::makeMove(Move& move) {
             undoStack[ply].moveType = CASTLING;
         }
 
-        if (move.piece == WHITE_KING) {
+        if (piece == WHITE_KING) {
             if (castlingRights & WHITE_KINGSIDE) {
                 zobristHash ^= getCastleZobristConstant(ZOBRIST_WHITE_KINGSIDE_INDEX);
                 castlingRights &= ~WHITE_KINGSIDE;
@@ -200,28 +213,28 @@ void Bitboard::makeMove(Move& move) {
         }
     }
 
-    if (move.piece == WHITE_ROOK) {
-        if (move.from == A1 && (castlingRights & WHITE_QUEENSIDE)) {
+    if (piece == WHITE_ROOK) {
+        if (from == A1 && (castlingRights & WHITE_QUEENSIDE)) {
             zobristHash ^= getCastleZobristConstant(ZOBRIST_WHITE_QUEENSIDE_INDEX);
             castlingRights &= ~WHITE_QUEENSIDE;
-        } else if (move.from == H1 && (castlingRights & WHITE_KINGSIDE)) {
+        } else if (from == H1 && (castlingRights & WHITE_KINGSIDE)) {
             zobristHash ^= getCastleZobristConstant(ZOBRIST_WHITE_KINGSIDE_INDEX);
             castlingRights &= ~WHITE_KINGSIDE;
         }
-    } else if (move.piece == BLACK_ROOK) {
-        if (move.from == A8 && (castlingRights & BLACK_QUEENSIDE)) {
+    } else if (piece == BLACK_ROOK) {
+        if (from == A8 && (castlingRights & BLACK_QUEENSIDE)) {
             zobristHash ^= getCastleZobristConstant(ZOBRIST_BLACK_QUEENSIDE_INDEX);
             castlingRights &= ~BLACK_QUEENSIDE;
-        } else if (move.from == H8 && (castlingRights & BLACK_KINGSIDE)) {
+        } else if (from == H8 && (castlingRights & BLACK_KINGSIDE)) {
             zobristHash ^= getCastleZobristConstant(ZOBRIST_BLACK_KINGSIDE_INDEX);
             castlingRights &= ~BLACK_KINGSIDE;
         }
     }
 
-    if (move.promotionPiece != EMPTY) {
-        setPiece(move.to, move.promotionPiece);
+    if (promotionPiece != EMPTY) {
+        setPiece(to, promotionPiece);
     } else {
-        setPiece(move.to, move.piece);
+        setPiece(to, piece);
     }
 
     if (movingColor == BLACK) {
@@ -239,39 +252,45 @@ int Bitboard::getHalfMoveClock() {
     return halfMoveClock;
 }
 
-void Bitboard::unmakeMove(Move& move) {
+void Bitboard::unmakeMove(Move move) {
+    int8_t from = getFromSquare(move);
+    int8_t to = getToSquare(move);
+    PieceColor color = getOppositeColor(movingColor);
+    PieceType promotionPiece = getPromotionPiece(move, color);
+    PieceType piece = promotionPiece == EMPTY ? getPieceOnSquare(to)
+                                              : (color == WHITE ? WHITE_PAWN : BLACK_PAWN);
     moveHistory[ply] = 0;
     UndoData undoData = undoStack[ply - 1];
 
-    if (move.promotionPiece != EMPTY) {
-        removePiece(move.to, move.promotionPiece);
+    if (promotionPiece != EMPTY) {
+        removePiece(to, promotionPiece);
     } else {
-        removePiece(move.to, move.piece);
+        removePiece(to, piece);
     }
 
     if (undoData.capturedPiece != EMPTY) {
-        setPiece(move.to, undoData.capturedPiece);
+        setPiece(to, undoData.capturedPiece);
     }
 
-    setPiece(move.from, move.piece);
+    setPiece(from, piece);
 
     if (undoData.moveType == EN_PASSANT) {
-        int8_t enPassantCaptureSquare = move.to - (getOppositeColor(movingColor) == WHITE ? 8 : -8);
+        int8_t enPassantCaptureSquare = to - (color == WHITE ? 8 : -8);
         setPiece(enPassantCaptureSquare,
-                 getOppositeColor(movingColor) == WHITE ? BLACK_PAWN : WHITE_PAWN);
+                 color == WHITE ? BLACK_PAWN : WHITE_PAWN);
     }
 
     if (undoData.moveType == CASTLING) {
-        if (move.to == G1) {
+        if (to == G1) {
             removePiece(F1, WHITE_ROOK);
             setPiece(H1, WHITE_ROOK);
-        } else if (move.to == C1) {
+        } else if (to == C1) {
             removePiece(D1, WHITE_ROOK);
             setPiece(A1, WHITE_ROOK);
-        } else if (move.to == G8) {
+        } else if (to == G8) {
             removePiece(F8, BLACK_ROOK);
             setPiece(H8, BLACK_ROOK);
-        } else if (move.to == C8) {
+        } else if (to == C8) {
             removePiece(D8, BLACK_ROOK);
             setPiece(A8, BLACK_ROOK);
         }
@@ -279,6 +298,7 @@ void Bitboard::unmakeMove(Move& move) {
 
     ply -= 1;
     halfMoveClock = undoData.halfMoveClock;
+    pliesFromNull = undoData.pliesFromNull;
     enPassantSquare = undoData.enPassantSquare;
     castlingRights = undoData.castlingRights;
     movingColor = getOppositeColor(movingColor);
@@ -293,6 +313,7 @@ void Bitboard::unmakeMove(Move& move) {
 void Bitboard::makeNullMove() {
     undoStack[ply].capturedPiece = EMPTY;
     undoStack[ply].halfMoveClock = halfMoveClock;
+    undoStack[ply].pliesFromNull = pliesFromNull;
     undoStack[ply].enPassantSquare = enPassantSquare;
     undoStack[ply].castlingRights = castlingRights;
     undoStack[ply].moveType = REGULAR;
@@ -306,14 +327,19 @@ void Bitboard::makeNullMove() {
 
     movingColor = getOppositeColor(movingColor);
     zobristHash ^= getMovingColorZobristConstant();
-    previousMove = {NO_SQUARE, NO_SQUARE, EMPTY, 0, EMPTY, 0};
+    previousMove = NO_MOVE;
+    pliesFromNull = 0;
     ply += 1;
+    moveHistory[ply] = zobristHash;
 }
 
 void Bitboard::unmakeNullMove() {
+    moveHistory[ply] = 0;
     ply -= 1;
     UndoData undoData = undoStack[ply];
 
+    halfMoveClock = undoData.halfMoveClock;
+    pliesFromNull = undoData.pliesFromNull;
     enPassantSquare = undoData.enPassantSquare;
     castlingRights = undoData.castlingRights;
     movingColor = getOppositeColor(movingColor);
@@ -321,7 +347,19 @@ void Bitboard::unmakeNullMove() {
     previousMove = undoData.previousMove;
 }
 
-const Move& Bitboard::getPreviousMove() const { return previousMove; }
+Move Bitboard::getPreviousMove() const { return previousMove; }
+
+bool Bitboard::isCapture(Move move) const {
+    int8_t to = getToSquare(move);
+
+    if (pieceSquareMapping[to] != EMPTY) {
+        return true;
+    }
+
+    return to == enPassantSquare && isPawn(pieceSquareMapping[getFromSquare(move)]);
+}
+
+bool Bitboard::isQuietMove(Move move) const { return !isPromotion(move) && !isCapture(move); }
 
 bool Bitboard::hasMinorOrMajorPieces() {
     return hasMinorOrMajorPieces<WHITE>() || hasMinorOrMajorPieces<BLACK>();
@@ -357,9 +395,7 @@ void Bitboard::printAvailableMoves(MoveList* moves) {
         bool didPrint = false;
 
         for (int i = 0; i < moves->size; i++) {
-            Move move = moves->moves[i];
-
-            if (move.to == index) {
+            if (getToSquare(moves->moves[i]) == index) {
                 std::cout << 'X' << " | ";
                 didPrint = true;
                 break;
@@ -407,10 +443,12 @@ bool Bitboard::setFromFen(const std::string& fen) {
     movingColor = NONE;
     ply = 0;
     halfMoveClock = 0;
+    pliesFromNull = 0;
     fullmoveClock = 1;
     enPassantSquare = NO_SQUARE;
     castlingRights = 0;
     zobristHash = 0;
+    pawnHash = 0;
     pstValues[0] = 0;
     pstValues[1] = 0;
     pstValues[2] = 0;
@@ -517,6 +555,7 @@ bool Bitboard::setFromFen(const std::string& fen) {
     }
 
     moveHistory[ply] = getZobristHash();
+    refreshAccumulator();
     return true;
 }
 
@@ -552,10 +591,12 @@ bool Bitboard::setFromFenTuner(const std::string& fen) {
     movingColor = NONE;
     ply = 0;
     halfMoveClock = 0;
+    pliesFromNull = 0;
     fullmoveClock = 1;
     enPassantSquare = NO_SQUARE;
     castlingRights = 0;
     zobristHash = 0;
+    pawnHash = 0;
     pstValues[0] = 0;
     pstValues[1] = 0;
     pstValues[2] = 0;
@@ -657,7 +698,7 @@ bool Bitboard::setFromFenTuner(const std::string& fen) {
     return true;
 }
 
-bool Bitboard::isDraw() {
+bool Bitboard::isDraw(int rootPly) {
     if (halfMoveClock >= 100) {
         return true;
     }
@@ -666,16 +707,53 @@ bool Bitboard::isDraw() {
         return true;
     }
 
-    // Check if the same position has occurred 3 times using the movehistory array
+    return isRepetition(rootPly);
+}
+
+// Only the positions since the last irreversible or null move can repeat, and only the ones with the
+// same side to move. A position that already occurred inside the search tree is scored as a draw, as
+// the side that can repeat it can keep doing so. Before the root, a real threefold is required.
+bool Bitboard::isRepetition(int rootPly) {
+    int end = std::min<int>({halfMoveClock, pliesFromNull, ply});
     int samePositionCount = 0;
-    uint64_t boardHash = getZobristHash();
 
-    for (int i = ply; i >= 0; i--) {
-        if (moveHistory[i] == boardHash) {
-            samePositionCount++;
+    for (int i = 4; i <= end; i += 2) {
+        if (moveHistory[ply - i] != zobristHash) {
+            continue;
+        }
+
+        if (ply - i > rootPly) {
+            return true;
+        }
+
+        samePositionCount += 1;
+
+        if (samePositionCount >= 2) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Checks if the side to move has a reversible move that leads to a position that already occurred
+// in the search tree, which means it can at least force a draw. Uses the cuckoo tables to find the
+// move from the difference between the zobrist hashes.
+bool Bitboard::hasUpcomingRepetition(int rootPly) {
+    int end = std::min<int>({halfMoveClock, pliesFromNull, ply});
+
+    for (int i = 3; i <= end; i += 2) {
+        Move move;
+
+        if (!findCuckooMove(zobristHash ^ moveHistory[ply - i], move)) {
+            continue;
+        }
+
+        if (getBetweenSquares(getFromSquare(move), getToSquare(move)) & occupiedBB) {
+            continue;
         }
 
-        if (samePositionCount >= 3) {
+        if (ply - i > rootPly) {
             return true;
         }
     }
@@ -685,6 +763,82 @@ bool Bitboard::isDraw() {
 
 uint64_t Bitboard::getZobristHash() const { return zobristHash; }
 
+// Cheaply computes the Zobrist hash of the position after the given move, without making it. Only
+// used to prefetch the TT, so the rook move of castling and en passant captures are not taken into
+// account.
+uint64_t Bitboard::getZobristHashAfterMove(Move move) {
+    int8_t from = getFromSquare(move);
+    int8_t to = getToSquare(move);
+    PieceType piece = getPieceOnSquare(from);
+    PieceType promotionPiece = getPromotionPiece(move, movingColor);
+    uint64_t hash = zobristHash ^ getMovingColorZobristConstant();
+    PieceType capturedPiece = getPieceOnSquare(to);
+
+    hash ^= getPieceZobristConstant(piece, from);
+
+    if (promotionPiece != EMPTY) {
+        hash ^= getPieceZobristConstant(promotionPiece, to);
+    } else {
+        hash ^= getPieceZobristConstant(piece, to);
+    }
+
+    if (capturedPiece != EMPTY) {
+        hash ^= getPieceZobristConstant(capturedPiece, to);
+    }
+
+    if (enPassantSquare != NO_SQUARE) {
+        hash ^= getEnPassantZobristConstant(enPassantSquare % 8);
+    }
+
+    if ((piece == WHITE_PAWN || piece == BLACK_PAWN) &&
+        std::abs(to - from) == 16) {
+        hash ^= getEnPassantZobristConstant(to % 8);
+    }
+
+    uint64_t lostCastlingRights = 0;
+
+    if (piece == WHITE_KING) {
+        lostCastlingRights = WHITE_KINGSIDE | WHITE_QUEENSIDE;
+    } else if (piece == BLACK_KING) {
+        lostCastlingRights = BLACK_KINGSIDE | BLACK_QUEENSIDE;
+    } else if (piece == WHITE_ROOK) {
+        lostCastlingRights = from == A1 ? WHITE_QUEENSIDE
+                             : from == H1 ? WHITE_KINGSIDE
+                             : 0;
+    } else if (piece == BLACK_ROOK) {
+        lostCastlingRights = from == A8 ? BLACK_QUEENSIDE
+                             : from == H8 ? BLACK_KINGSIDE
+                             : 0;
+    }
+
+    lostCastlingRights &= castlingRights;
+
+    // The castling right bits are in the same order as their Zobrist constants
+    while (lostCastlingRights) {
+        hash ^= getCastleZobristConstant(popLsb(lostCastlingRights));
+    }
+
+    return hash;
+}
+
+uint64_t Bitboard::getPawnHash() const { return pawnHash; }
+
+const Accumulator& Bitboard::getAccumulator() const { return accumulator; }
+
+void Bitboard::refreshAccumulator() {
+    if (!isNnueEnabled()) {
+        return;
+    }
+
+    resetAccumulator(accumulator);
+
+    for (int8_t square = 0; square < SQUARES; square++) {
+        if (pieceSquareMapping[square] != EMPTY) {
+            addFeature(accumulator, pieceSquareMapping[square], square);
+        }
+    }
+}
+
 void Bitboard::setZobristHash(uint64_t zobristHash) { Bitboard::zobristHash = zobristHash; }
 
 bool Bitboard::isInsufficientMaterial() {
@@ -804,20 +958,11 @@ bool Bitboard::makeStrMove(const std::string& strMove) {
         }
     }
 
-    PieceType movingPiece = getPieceOnSquare(fromSquare);
-    PieceType capturedPiece = getPieceOnSquare(toSquare);
-    int captureScore = -1;
-
-    if (capturedPiece != EMPTY) {
-        captureScore = mvvlva(movingPiece, capturedPiece);
-    }
-
-    Move move = {fromSquare, toSquare, movingPiece, captureScore, promotionPiece};
-    makeMove(move);
+    makeMove(encodeMove(fromSquare, toSquare, promotionPiece));
     return true;
 }
 
-Line Bitboard::getPvLine() { return pvLine; }
+const Line& Bitboard::getPvLine() const { return pvLine; }
 
 void Bitboard::setPvLine(Line& pvLine) {
     Bitboard::pvLine = pvLine;
@@ -856,34 +1001,10 @@ bool Bitboard::isWinner() {
         }
     }
 
-    MoveListPool* moveListPool = MoveListPool::getInstance();
-    MoveList* moveList = moveListPool->getMoveList();
-    generateMoves<color == WHITE ? BLACK : WHITE, NORMAL>(*this, moveList);
-
-    for (int i = 0; i < moveList->size; i++) {
-        Move move = moveList->moves[i];
-
-        makeMove(move);
+    MoveList moveList{};
+    generateMoves<color == WHITE ? BLACK : WHITE, NORMAL>(*this, &moveList);
 
-        if (color == WHITE) {
-            if (isKingInCheck<BLACK>()) {
-                unmakeMove(move);
-                continue;
-            }
-        } else {
-            if (isKingInCheck<WHITE>()) {
-                unmakeMove(move);
-                continue;
-            }
-        }
-
-        unmakeMove(move);
-        moveListPool->releaseMoveList(moveList);
-        return false;
-    }
-
-    moveListPool->releaseMoveList(moveList);
-    return true;
+    return moveList.size == 0;
 }
 
 template bool Bitboard::isWinner<WHITE>();
@@ -29,7 +29,7 @@
 #include <string>
 
 #include "bitwise.h"
-#include "movelist_pool.h"
+#include "nnue.h"
 #include "types.h"
 #include "utils.h"
 
@@ -44,11 +44,16 @@ private:
     PieceColor movingColor = NONE;
     uint16_t ply = 0;
     uint8_t halfMoveClock = 0;
+    // The positions before a null move can not be repeated by legal moves, so the repetition checks
+    // don't look further back than this
+    uint16_t pliesFromNull = 0;
     uint8_t fullmoveClock = 1;
     int8_t enPassantSquare = NO_SQUARE;
     uint8_t castlingRights = 0b00001111;
 
     uint64_t zobristHash = 0ULL;
+    // Zobrist hash of only the pawns, used as key for the pawn hash table
+    uint64_t pawnHash = 0ULL;
 
     UndoData undoStack[MAX_PLY]{};
     uint64_t moveHistory[MAX_PLY]{};
@@ -59,6 +64,9 @@ private:
     Move previousMove{};
     int materialCount[12]{};
 
+    // Only kept up to date while NNUE is enabled
+    Accumulator accumulator{};
+
 public:
     uint64_t getPieceBoard(PieceType pieceType);
 
@@ -122,10 +130,10 @@ public:
         return materialCount[piece];
     }
 
-    void makeMove(Move& move);
+    void makeMove(Move move);
     int getHalfMoveClock();
 
-    void unmakeMove(Move& move);
+    void unmakeMove(Move move);
 
     void print();
 
@@ -135,7 +143,12 @@ public:
 
     bool setFromFenTuner(const std::string& fen);
 
-    bool isDraw();
+    // Positions at or before rootPly belong to the game, the ones after it to the search tree
+    bool isDraw(int rootPly);
+
+    bool isRepetition(int rootPly);
+
+    bool hasUpcomingRepetition(int rootPly);
 
     template <PieceColor color>
     bool isWinner();
@@ -207,11 +220,19 @@ public:
 
     uint64_t getZobristHash() const;
 
+    uint64_t getZobristHashAfterMove(Move move);
+
+    uint64_t getPawnHash() const;
+
+    const Accumulator& getAccumulator() const;
+
+    void refreshAccumulator();
+
     void setZobristHash(uint64_t zobristHash);
 
     bool makeStrMove(const std::string& strMove);
 
-    Line getPvLine();
+    const Line& getPvLine() const;
 
     void setPvLine(Line& pvLine);
 
@@ -256,10 +277,8 @@ public:
     template <PieceColor attackingColor>
     int seeCapture(int8_t fromSquare, int8_t toSquare) {
         constexpr PieceColor OPPOSITE_COLOR = attackingColor == WHITE ? BLACK : WHITE;
-        PieceType movingPiece = pieceSquareMapping[fromSquare];
         PieceType capturedPieceType = pieceSquareMapping[toSquare];
-        int captureScore = mvvlva(movingPiece, capturedPieceType);
-        Move move{fromSquare, toSquare, movingPiece, captureScore};
+        Move move = encodeMove(fromSquare, toSquare);
 
         makeMove(move);
         int score = getPieceWeight(capturedPieceType) - see<OPPOSITE_COLOR>(toSquare);
@@ -295,10 +314,8 @@ public:
         int8_t smallestAttackerSquare = getSmallestAttackerSquare<attackingColor>(square);
 
         if (smallestAttackerSquare != NO_SQUARE) {
-            PieceType movingPiece = pieceSquareMapping[smallestAttackerSquare];
             PieceType capturedPieceType = pieceSquareMapping[square];
-            int captureScore = mvvlva(movingPiece, capturedPieceType);
-            Move move{smallestAttackerSquare, square, movingPiece, captureScore};
+            Move move = encodeMove(smallestAttackerSquare, square);
             makeMove(move);
             score = std::max(0, getPieceWeight(capturedPieceType) - see<OPPOSITE_COLOR>(square));
             unmakeMove(move);
@@ -317,10 +334,8 @@ public:
         int8_t smallestAttackerSquare = getSmallestAttackerSquare<OPPOSITE_COLOR>(square);
 
         if (smallestAttackerSquare != NO_SQUARE) {
-            PieceType movingPiece = pieceSquareMapping[smallestAttackerSquare];
             PieceType capturedPieceType = pieceSquareMapping[square];
-            int captureScore = mvvlva(movingPiece, capturedPieceType);
-            Move move{smallestAttackerSquare, square, movingPiece, captureScore};
+            Move move = encodeMove(smallestAttackerSquare, square);
             makeMove(move);
             score = getPieceWeight(capturedPieceType) - see<OPPOSITE_COLOR>(square);
             unmakeMove(move);
@@ -329,7 +344,13 @@ public:
         return score;
     }
 
-    [[nodiscard]] const Move& getPreviousMove() const;
+    [[nodiscard]] Move getPreviousMove() const;
+
+    // Whether the move captures a piece, including en passant captures
+    [[nodiscard]] bool isCapture(Move move) const;
+
+    // Whether the move is neither a capture nor a promotion
+    [[nodiscard]] bool isQuietMove(Move move) const;
 
     uint64_t getFile(int8_t square);
 
@@ -24,6 +24,8 @@
 #include <random>
 #include <algorithm>
 
+#include "utils.h"
+
 namespace Zagreus {
 static uint64_t kingAttacks[64]{};
 static uint64_t knightAttacks[64]{};
@@ -36,6 +38,17 @@ static uint64_t zobristMovingColorConstant{};
 static uint64_t zobristCastleConstants[4]{};
 static uint64_t zobristEnPassantConstants[8]{};
 
+// Cuckoo tables holding the zobrist key difference of every reversible non-pawn move, so a move that
+// leads back to an earlier position can be found from the two keys alone. Each key lives at one of
+// its two hash slots.
+static constexpr int CUCKOO_TABLE_SIZE = 8192;
+static uint64_t cuckooKeys[CUCKOO_TABLE_SIZE]{};
+static Move cuckooMoves[CUCKOO_TABLE_SIZE]{};
+
+static int cuckooH1(uint64_t key) { return static_cast<int>(key & 0x1FFF); }
+
+static int cuckooH2(uint64_t key) { return static_cast<int>((key >> 16) & 0x1FFF); }
+
 uint64_t soutOne(uint64_t b) { return b >> 8ULL; }
 
 uint64_t nortOne(uint64_t b) { return b << 8ULL; }
@@ -248,6 +261,75 @@ void initializeBitboardConstants() {
 
     initializeBetweenLookup();
     initializeRayAttacks();
+    initializeCuckooTables();
+}
+
+static uint64_t getEmptyBoardAttacks(int pieceType, int8_t square) {
+    uint64_t rookAttacks = rayAttacks[NORTH][square] | rayAttacks[SOUTH][square]
+                           | rayAttacks[EAST][square] | rayAttacks[WEST][square];
+    uint64_t bishopAttacks = rayAttacks[NORTH_EAST][square] | rayAttacks[NORTH_WEST][square]
+                             | rayAttacks[SOUTH_EAST][square] | rayAttacks[SOUTH_WEST][square];
+
+    switch (pieceType / 2) {
+        case 1:
+            return knightAttacks[square];
+        case 2:
+            return bishopAttacks;
+        case 3:
+            return rookAttacks;
+        case 4:
+            return rookAttacks | bishopAttacks;
+        case 5:
+            return kingAttacks[square];
+        default:
+            return 0ULL;
+    }
+}
+
+void initializeCuckooTables() {
+    for (int pieceType = WHITE_KNIGHT; pieceType < PIECE_TYPES; pieceType++) {
+        for (int8_t from = 0; from < SQUARES; from++) {
+            uint64_t attacks = getEmptyBoardAttacks(pieceType, from);
+
+            for (int8_t to = from + 1; to < SQUARES; to++) {
+                if (!(attacks & 1ULL << to)) {
+                    continue;
+                }
+
+                uint64_t key = zobristPieceConstants[pieceType][from]
+                               ^ zobristPieceConstants[pieceType][to] ^ zobristMovingColorConstant;
+                Move move = encodeMove(from, to);
+                int index = cuckooH1(key);
+
+                // Kick the entry in the slot out to its other slot until an empty slot is found
+                while (true) {
+                    std::swap(cuckooKeys[index], key);
+                    std::swap(cuckooMoves[index], move);
+
+                    if (key == 0ULL) {
+                        break;
+                    }
+
+                    index = index == cuckooH1(key) ? cuckooH2(key) : cuckooH1(key);
+                }
+            }
+        }
+    }
+}
+
+bool findCuckooMove(uint64_t moveKey, Move& move) {
+    int index = cuckooH1(moveKey);
+
+    if (cuckooKeys[index] != moveKey) {
+        index = cuckooH2(moveKey);
+
+        if (cuckooKeys[index] != moveKey) {
+            return false;
+        }
+    }
+
+    move = cuckooMoves[index];
+    return true;
 }
 
 void initializeBetweenLookup() {
@@ -101,6 +101,11 @@ void initializeRayAttacks();
 
 void initializeBitboardConstants();
 
+void initializeCuckooTables();
+
+// Finds the reversible move whose zobrist key difference (including the side to move) is moveKey
+bool findCuckooMove(uint64_t moveKey, Move& move);
+
 uint64_t getKingAttacks(int8_t square);
 
 uint64_t getKnightAttacks(int8_t square);
@@ -35,6 +35,13 @@ static constexpr int MATE_SCORE = 20000;
 static constexpr int MAX_POSITIVE = 1000000;
 static constexpr int MAX_NEGATIVE = -1000000;
 static constexpr int DRAW_SCORE = 0;
+// Half the width of the first aspiration window around the score of the previous iteration. The
+// window doubles on every fail, and the search falls back to the full window after the max fails.
+static constexpr int ASPIRATION_DELTA = 100;
+static constexpr int ASPIRATION_MAX_FAILS = 2;
+static constexpr int ASPIRATION_MIN_DEPTH = 4;
+// The number of nodes between two checks of the clock and the stop flag during the search
+static constexpr int STOP_CHECK_INTERVAL = 1024;
 
 static constexpr uint64_t A_FILE = 0x0101010101010101ULL;
 static constexpr uint64_t B_FILE = 0x0202020202020202ULL;
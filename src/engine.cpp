@@ -21,19 +21,53 @@
 #include "engine.h"
 
 #include <algorithm>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "../senjo/ChessEngine.h"
 #include "../senjo/Output.h"
 #include "../senjo/GoParams.h"
 #include "../senjo/SearchStats.h"
 #include "bitboard.h"
+#include "eval_cache.h"
 #include "movegen.h"
+#include "nnue.h"
+#include "perft.h"
 #include "search.h"
 #include "tt.h"
 #include "types.h"
 #include "utils.h"
 
 namespace Zagreus {
+ZagreusEngine::ZagreusEngine() { setThreadCount(getOption("Threads").getIntValue()); }
+
+void ZagreusEngine::setThreadCount(int threadCount) {
+    searchThreads.clear();
+
+    for (int i = 0; i < threadCount; i++) {
+        std::unique_ptr<ThreadData> thread = std::make_unique<ThreadData>();
+        thread->threadId = i;
+        searchThreads.push_back(std::move(thread));
+    }
+}
+
+void ZagreusEngine::updateEvaluationBackend() {
+    bool useNnue = getOption("UseNNUE").getValue() == "true";
+
+    if (useNnue && !isNetworkLoaded()) {
+        senjo::Output(senjo::Output::InfoPrefix)
+            << "No NNUE network loaded, using the hand-crafted evaluation";
+    }
+
+    setNnueEnabled(useNnue);
+    board.refreshAccumulator();
+    // The cached scores belong to the previous evaluation
+    EvalCache::getEvalCache()->reset();
+}
+
+ThreadData& ZagreusEngine::getMainThread() { return *searchThreads[0]; }
+
 uint64_t ZagreusEngine::doPerft(Bitboard& perftBoard, PieceColor color, int16_t depth,
                                 int startingDepth) {
     uint64_t nodes = 0ULL;
@@ -42,15 +76,13 @@ uint64_t ZagreusEngine::doPerft(Bitboard& perftBoard, PieceColor color, int16_t
         return 1ULL;
     }
 
-    MoveListPool* moveListPool = MoveListPool::getInstance();
-    MoveList* moves = moveListPool->getMoveList();
+    MoveList* moves = getMainThread().getMoveList(perftBoard.getPly());
 
     if (color == WHITE) {
         generateMoves<WHITE, NORMAL>(perftBoard, moves);
     } else if (color == BLACK) {
         generateMoves<BLACK, NORMAL>(perftBoard, moves);
     } else {
-        moveListPool->releaseMoveList(moves);
         return 0;
     }
 
@@ -58,31 +90,80 @@ uint64_t ZagreusEngine::doPerft(Bitboard& perftBoard, PieceColor color, int16_t
         Move move = moves->moves[i];
 
         perftBoard.makeMove(move);
-
-        if (color == WHITE) {
-            if (perftBoard.isKingInCheck<WHITE>()) {
-                perftBoard.unmakeMove(move);
-                continue;
-            }
-        } else {
-            if (perftBoard.isKingInCheck<BLACK>()) {
-                perftBoard.unmakeMove(move);
-                continue;
-            }
-        }
-
         uint64_t nodeAmount = doPerft(perftBoard, getOppositeColor(color), depth - 1,
                                       startingDepth);
         nodes += nodeAmount;
         perftBoard.unmakeMove(move);
 
         if (depth == startingDepth && nodeAmount > 0ULL) {
-            std::string notation = getNotation(move.from) + getNotation(move.to);
+            std::string notation = getMoveNotation(move);
             senjo::Output(senjo::Output::NoPrefix) << notation << ": " << nodeAmount;
         }
     }
 
-    moveListPool->releaseMoveList(moves);
+    return nodes;
+}
+
+// Bulk counting, hashed perft. The root moves are divided over the threads: every thread takes the
+// next root move that has not been counted yet, until all of them are done.
+uint64_t ZagreusEngine::doBulkPerft(Bitboard& perftBoard, int16_t depth, bool printDivide) {
+    if (depth <= 0) {
+        return 1ULL;
+    }
+
+    PerftTable table(getOption("PerftHash").getIntValue());
+    MoveList rootMoves{};
+
+    if (perftBoard.getMovingColor() == WHITE) {
+        generateMoves<WHITE, NORMAL>(perftBoard, &rootMoves);
+    } else {
+        generateMoves<BLACK, NORMAL>(perftBoard, &rootMoves);
+    }
+
+    std::vector<uint64_t> moveNodes(rootMoves.size, 0ULL);
+    std::atomic<int> nextMove = 0;
+
+    auto countRootMoves = [&](ThreadData* thread) {
+        thread->board = perftBoard;
+
+        for (int i = nextMove++; i < rootMoves.size; i = nextMove++) {
+            Move move = rootMoves.moves[i];
+
+            thread->board.makeMove(move);
+
+            if (perftBoard.getMovingColor() == WHITE) {
+                moveNodes[i] = bulkPerft<BLACK>(*thread, depth - 1, table);
+            } else {
+                moveNodes[i] = bulkPerft<WHITE>(*thread, depth - 1, table);
+            }
+
+            thread->board.unmakeMove(move);
+        }
+    };
+
+    std::vector<std::thread> helperThreads{};
+
+    for (size_t i = 1; i < searchThreads.size(); i++) {
+        helperThreads.emplace_back(countRootMoves, searchThreads[i].get());
+    }
+
+    countRootMoves(&getMainThread());
+
+    for (std::thread& helperThread : helperThreads) {
+        helperThread.join();
+    }
+
+    uint64_t nodes = 0ULL;
+
+    for (int i = 0; i < rootMoves.size; i++) {
+        nodes += moveNodes[i];
+
+        if (printDivide) {
+            senjo::Output(senjo::Output::NoPrefix)
+                << getMoveNotation(rootMoves.moves[i]) << ": " << moveNodes[i];
+        }
+    }
+
     return nodes;
 }
 
@@ -122,7 +203,21 @@ bool ZagreusEngine::setEngineOption(const std::string& optionName, const std::st
             option.setValue(optionValue);
 
             if (option.getName() == "Hash") {
-                TranspositionTable::getTT()->setTableSize(option.getIntValue());
+                TranspositionTable::getTT()->setTableSize(option.getIntValue(),
+                                                          getOption("Threads").getIntValue());
+            } else if (option.getName() == "EvalCache") {
+                EvalCache::getEvalCache()->setTableSize(option.getIntValue());
+            } else if (option.getName() == "Threads") {
+                setThreadCount(option.getIntValue());
+            } else if (option.getName() == "EvalFile") {
+                if (!optionValue.empty() && !loadNetwork(optionValue)) {
+                    senjo::Output(senjo::Output::InfoPrefix)
+                        << "Failed to load NNUE network " << optionValue;
+                }
+
+                updateEvaluationBackend();
+            } else if (option.getName() == "UseNNUE") {
+                updateEvaluationBackend();
             }
 
             return true;
@@ -135,7 +230,9 @@ bool ZagreusEngine::setEngineOption(const std::string& optionName, const std::st
 void ZagreusEngine::initialize() {
     stoppingSearch = false;
     board = Bitboard{};
-    TranspositionTable::getTT()->setTableSize(getOption("Hash").getIntValue());
+    TranspositionTable::getTT()->setTableSize(getOption("Hash").getIntValue(),
+                                              getOption("Threads").getIntValue());
+    EvalCache::getEvalCache()->setTableSize(getOption("EvalCache").getIntValue());
     isEngineInitialized = true;
 }
 
@@ -164,7 +261,15 @@ bool ZagreusEngine::whiteToMove() { return board.getMovingColor() == WHITE; }
 void ZagreusEngine::clearSearchData() {
 }
 
+// The search keeps running, the main thread picks up the change at its next time check and starts
+// the clock from there
 void ZagreusEngine::ponderHit() {
+    {
+        std::lock_guard<std::mutex> lock(searchStateMutex);
+        pondering = false;
+    }
+
+    searchStateChanged.notify_all();
 }
 
 bool ZagreusEngine::isRegistered() { return true; }
@@ -180,74 +285,160 @@ bool ZagreusEngine::isCopyProtected() { return false; }
 
 bool ZagreusEngine::copyIsOK() { return true; }
 
-void ZagreusEngine::setDebug(const bool flag) {
-}
+void ZagreusEngine::setDebug(const bool flag) { debug = flag; }
 
-bool ZagreusEngine::isDebugOn() { return false; }
+bool ZagreusEngine::isDebugOn() { return debug; }
 
 bool ZagreusEngine::isSearching() {
     return searching;
 }
 
-void ZagreusEngine::stopSearching() { stoppingSearch = true; }
+void ZagreusEngine::stopSearching() {
+    stoppingSearch = true;
+
+    {
+        std::lock_guard<std::mutex> lock(searchStateMutex);
+        pondering = false;
+    }
+
+    searchStateChanged.notify_all();
+}
 
 bool ZagreusEngine::stopRequested() { return stoppingSearch; }
 
 void ZagreusEngine::waitForSearchFinish() {
-    while (isSearching()) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    }
+    std::unique_lock<std::mutex> lock(searchStateMutex);
+    searchStateChanged.wait(lock, [this]() { return !searching; });
 }
 
 uint64_t ZagreusEngine::perft(const int16_t depth) {
     stoppingSearch = false;
     auto start = std::chrono::steady_clock::now();
-    uint64_t nodes = doPerft(board, board.getMovingColor(), depth, depth);
+    uint64_t nodes = doBulkPerft(board, depth, true);
     auto end = std::chrono::steady_clock::now();
     std::chrono::duration<double> elapsedSeconds = end - start;
 
     senjo::Output(senjo::Output::InfoPrefix)
         << "Depth " << depth << " Nodes: " << nodes
-        << ", Took: " << elapsedSeconds.count() << "s";
+        << ", Took: " << elapsedSeconds.count() << "s"
+        << ", NPS: " << static_cast<uint64_t>(nodes / std::max(elapsedSeconds.count(), 0.001));
     return nodes;
 }
 
-std::string ZagreusEngine::go(senjo::GoParams& params, std::string* ponder) {
+// The flags are set before the search thread starts, so a stop or ponderhit that is read right after
+// the go command is never overwritten by the search thread
+void ZagreusEngine::prepareSearch(const senjo::GoParams& params) {
     stoppingSearch = false;
+    pondering = params.ponder;
     searching = true;
-    searchStats = {};
-    Move bestMove;
+}
+
+std::string ZagreusEngine::go(senjo::GoParams& params, std::string* ponder) {
+    Move bestMove = NO_MOVE;
+
+    TranspositionTable::getTT()->incrementGeneration();
+
+    for (std::unique_ptr<ThreadData>& thread : searchThreads) {
+        thread->board = board;
+        thread->searchStats = {};
+        thread->publishedNodes.store(0, std::memory_order_relaxed);
+        thread->evalCacheHits = 0;
+        thread->evalCacheMisses = 0;
+    }
+
+    // Lazy SMP: the helper threads search the same position and only share their results through
+    // the transposition table. The move of the main thread is the one that gets played.
+    std::vector<std::thread> helperThreads{};
+
+    for (size_t i = 1; i < searchThreads.size(); i++) {
+        ThreadData* thread = searchThreads[i].get();
+
+        helperThreads.emplace_back([this, params, thread]() {
+            if (thread->board.getMovingColor() == WHITE) {
+                getBestMove<WHITE>(params, *this, *thread);
+            } else {
+                getBestMove<BLACK>(params, *this, *thread);
+            }
+        });
+    }
+
+    ThreadData& mainThread = getMainThread();
 
     if (board.getMovingColor() == WHITE) {
-        bestMove = getBestMove<WHITE>(params, *this, board, searchStats);
+        bestMove = getBestMove<WHITE>(params, *this, mainThread);
     } else {
-        bestMove = getBestMove<BLACK>(params, *this, board, searchStats);
+        bestMove = getBestMove<BLACK>(params, *this, mainThread);
     }
 
-    if (bestMove.promotionPiece != EMPTY) {
-        std::string result = getNotation(bestMove.from) + getNotation(bestMove.to) +
-                             getCharacterForPieceType(bestMove.promotionPiece);
+    stopSearching();
 
-        std::transform(result.begin(), result.end(), result.begin(),
-                       [](unsigned char c) { return std::tolower(c); });
+    for (std::thread& helperThread : helperThreads) {
+        helperThread.join();
+    }
 
-        searching = false;
-        return result;
+    if (debug) {
+        showEngineStats();
     }
 
-    std::string result = getNotation(bestMove.from) + getNotation(bestMove.to);
+    std::string result = getMoveNotation(bestMove);
+    const Line& pvLine = mainThread.board.getPvLine();
 
-    searching = false;
-    searching = true;
-    return getNotation(bestMove.from) + getNotation(bestMove.to);
+    // The reply the PV expects is the move to ponder on
+    if (ponder != nullptr && pvLine.moveCount > 1 && pvLine.moves[0] == bestMove) {
+        *ponder = getMoveNotation(pvLine.moves[1]);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(searchStateMutex);
+        searching = false;
+    }
+
+    searchStateChanged.notify_all();
+    return result;
 }
 
-senjo::SearchStats ZagreusEngine::getSearchStats() { return searchStats; }
+senjo::SearchStats ZagreusEngine::getSearchStats() {
+    senjo::SearchStats searchStats = getMainThread().searchStats;
+
+    // The helper threads are still searching, so their published snapshot is read instead of
+    // their counters
+    for (size_t i = 1; i < searchThreads.size(); i++) {
+        searchStats.nodes += searchThreads[i]->publishedNodes.load(std::memory_order_relaxed);
+    }
+
+    searchStats.hashfull = TranspositionTable::getTT()->getHashfull();
+
+    return searchStats;
+}
 
 void ZagreusEngine::resetEngineStats() {
+    for (std::unique_ptr<ThreadData>& thread : searchThreads) {
+        thread->evalCacheHits = 0;
+        thread->evalCacheMisses = 0;
+    }
 }
 
 void ZagreusEngine::showEngineStats() {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+
+    for (std::unique_ptr<ThreadData>& thread : searchThreads) {
+        hits += thread->evalCacheHits;
+        misses += thread->evalCacheMisses;
+    }
+
+    uint64_t probes = std::max(hits + misses, static_cast<uint64_t>(1));
+
+    senjo::Output(senjo::Output::InfoPrefix)
+        << "evalcache hits " << hits << " misses " << misses << " hitrate "
+        << hits * 100 / probes << "%";
+}
+
+bool ZagreusEngine::isPondering() const { return pondering; }
+
+void ZagreusEngine::waitWhilePondering() {
+    std::unique_lock<std::mutex> lock(searchStateMutex);
+    searchStateChanged.wait(lock, [this]() { return !pondering; });
 }
 
 bool ZagreusEngine::isTuning() const { return tuning; }
@@ -20,10 +20,16 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include "../senjo/ChessEngine.h"
 #include "bitboard.h"
+#include "thread_data.h"
 #include "types.h"
 
 namespace Zagreus {
@@ -31,20 +37,39 @@ class ZagreusEngine : public senjo::ChessEngine {
 private:
     Bitboard board{};
     bool isEngineInitialized = false;
-    senjo::SearchStats searchStats{};
-    bool stoppingSearch = false;
-    bool searching = false;
+    // Index 0 is the main thread, every other entry is a Lazy SMP helper thread
+    std::vector<std::unique_ptr<ThreadData>> searchThreads{};
+    std::atomic<bool> stoppingSearch = false;
+    // Set by "go ponder", cleared by "ponderhit" and "stop"
+    std::atomic<bool> pondering = false;
+    std::atomic<bool> searching = false;
+    // Notified when the search finishes and when pondering ends. The flags are changed while
+    // holding the mutex, so a waiting thread can't miss the notification.
+    std::mutex searchStateMutex{};
+    std::condition_variable searchStateChanged{};
     bool tuning = false;
+    bool debug = false;
 
     std::list<senjo::EngineOption> options{
         senjo::EngineOption("MoveOverhead", "50", senjo::EngineOption::OptionType::Spin, 0, 5000),
+        senjo::EngineOption("Ponder", "false", senjo::EngineOption::OptionType::Checkbox),
         senjo::EngineOption("Hash", "512", senjo::EngineOption::OptionType::Spin, 1, 33554432),
-        senjo::EngineOption("Threads", "1", senjo::EngineOption::OptionType::Spin, 1, 1),
+        senjo::EngineOption("EvalCache", "16", senjo::EngineOption::OptionType::Spin, 1, 4096),
+        senjo::EngineOption("Threads", "1", senjo::EngineOption::OptionType::Spin, 1, 1024),
+        senjo::EngineOption("PerftHash", "64", senjo::EngineOption::OptionType::Spin, 1, 65536),
+        senjo::EngineOption("EvalFile", "", senjo::EngineOption::OptionType::String),
+        senjo::EngineOption("UseNNUE", "false", senjo::EngineOption::OptionType::Checkbox),
         senjo::EngineOption("SyzygyPath", "", senjo::EngineOption::OptionType::String),
         senjo::EngineOption("SyzygyProbeLimit", "0", senjo::EngineOption::OptionType::Spin, 0, 100),
     };
 
+    void setThreadCount(int threadCount);
+
+    void updateEvaluationBackend();
+
 public:
+    ZagreusEngine();
+
     //        uint64_t doPerft(Zagreus::Bitboard &board, Zagreus::PieceColor color, int16_t depth, int
     //        startingDepth);
 
@@ -104,6 +129,8 @@ public:
 
     uint64_t perft(const int16_t depth) override;
 
+    void prepareSearch(const senjo::GoParams& params) override;
+
     std::string go(senjo::GoParams& params, std::string* ponder) override;
 
     senjo::SearchStats getSearchStats() override;
@@ -114,8 +141,16 @@ public:
 
     senjo::EngineOption getOption(const std::string& optionName);
 
+    ThreadData& getMainThread();
+
     uint64_t doPerft(Bitboard& perftBoard, PieceColor color, int16_t depth, int startingDepth);
 
+    uint64_t doBulkPerft(Bitboard& perftBoard, int16_t depth, bool printDivide);
+
+    bool isPondering() const;
+
+    void waitWhilePondering();
+
     bool isTuning() const;
 
     void setTuning(bool tuning);
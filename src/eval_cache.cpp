@@ -0,0 +1,70 @@
+/*
+ This file is part of Zagreus.
+
+ Zagreus is a UCI chess engine
+ Copyright (C) 2023-2024  Danny Jelsma
+
+ Zagreus is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published
+ by the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Zagreus is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with Zagreus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "eval_cache.h"
+
+#include <cmath>
+
+namespace Zagreus {
+static constexpr uint64_t KEY_MASK = 0xFFFFFFFFFFFF0000ULL;
+
+bool EvalCache::probe(uint64_t zobristHash, int& score) {
+    uint64_t entry = entries[zobristHash & entryMask].load(std::memory_order_relaxed);
+
+    if (entry == 0 || (entry & KEY_MASK) != (zobristHash & KEY_MASK)) {
+        return false;
+    }
+
+    score = static_cast<int16_t>(entry & 0xFFFF);
+    return true;
+}
+
+void EvalCache::store(uint64_t zobristHash, int score) {
+    if (score < INT16_MIN || score > INT16_MAX) {
+        return;
+    }
+
+    uint64_t entry = (zobristHash & KEY_MASK) | static_cast<uint16_t>(score);
+    entries[zobristHash & entryMask].store(entry, std::memory_order_relaxed);
+}
+
+void EvalCache::setTableSize(int megaBytes) {
+    if ((megaBytes & (megaBytes - 1)) != 0) {
+        megaBytes = 1 << static_cast<int>(log2(megaBytes));
+    }
+
+    uint64_t entryCount = static_cast<uint64_t>(megaBytes) * 1024 * 1024 / sizeof(uint64_t);
+
+    delete[] entries;
+    entries = new std::atomic<uint64_t>[entryCount]{};
+    entryMask = entryCount - 1;
+}
+
+void EvalCache::reset() {
+    for (uint64_t i = 0; i <= entryMask; i++) {
+        entries[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+EvalCache* EvalCache::getEvalCache() {
+    static EvalCache instance{};
+    return &instance;
+}
+} // namespace Zagreus
@@ -0,0 +1,54 @@
+/*
+ This file is part of Zagreus.
+
+ Zagreus is a UCI chess engine
+ Copyright (C) 2023-2024  Danny Jelsma
+
+ Zagreus is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published
+ by the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Zagreus is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with Zagreus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace Zagreus {
+// Caches the static evaluation of positions by their zobrist hash. Every entry is a single 64-bit
+// word holding the upper 48 bits of the hash and the 16-bit score, so reading and writing an entry
+// is atomic and the cache can be shared between all search threads without any locking.
+class EvalCache {
+private:
+    std::atomic<uint64_t>* entries = nullptr;
+    uint64_t entryMask = 0;
+
+public:
+    EvalCache() { setTableSize(1); }
+
+    ~EvalCache() { delete[] entries; }
+
+    EvalCache(EvalCache& other) = delete;
+
+    void operator=(const EvalCache&) = delete;
+
+    static EvalCache* getEvalCache();
+
+    void setTableSize(int megaBytes);
+
+    bool probe(uint64_t zobristHash, int& score);
+
+    void store(uint64_t zobristHash, int score);
+
+    void reset();
+};
+} // namespace Zagreus
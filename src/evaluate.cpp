@@ -17,7 +17,6 @@
  You should have received a copy of the GNU Affero General Public License
  along with Zagreus.  If not, see <https://www.gnu.org/licenses/>.
  */
-
 #include "evaluate.h"
 
 #include <algorithm>
@@ -25,135 +24,44 @@
 #include "features.h"
 
 namespace Zagreus {
-void Evaluation::initEvalContext(Bitboard& bitboard) {
-    uint64_t whitePawns = bitboard.getPieceBoard(WHITE_PAWN);
-    while (whitePawns) {
-        uint8_t square = popLsb(whitePawns);
-        uint64_t attacks = getPawnAttacks<WHITE>(square);
-
-        attacksByPiece[WHITE_PAWN] |= attacks;
-        attackedBy2[WHITE] |= (attacks & attacksByColor[WHITE]);
-        attacksByColor[WHITE] |= attacks;
-        attacksFrom[square] |= attacks;
-    }
-
-    uint64_t whiteKnights = bitboard.getPieceBoard(WHITE_KNIGHT);
-    while (whiteKnights) {
-        uint8_t square = popLsb(whiteKnights);
-        uint64_t attacks = getKnightAttacks(square);
-
-        attacksByPiece[WHITE_KNIGHT] |= attacks;
-        attackedBy2[WHITE] |= (attacks & attacksByColor[WHITE]);
-        attacksByColor[WHITE] |= attacks;
-        attacksFrom[square] |= attacks;
-    }
-
-    uint64_t whiteBishops = bitboard.getPieceBoard(WHITE_BISHOP);
-    while (whiteBishops) {
-        uint8_t square = popLsb(whiteBishops);
-        uint64_t attacks = bitboard.getBishopAttacks(square);
-
-        attacksByPiece[WHITE_BISHOP] |= attacks;
-        attackedBy2[WHITE] |= (attacks & attacksByColor[WHITE]);
-        attacksByColor[WHITE] |= attacks;
-        attacksFrom[square] |= attacks;
-    }
-
-    uint64_t whiteRooks = bitboard.getPieceBoard(WHITE_ROOK);
-    while (whiteRooks) {
-        uint8_t square = popLsb(whiteRooks);
-        uint64_t attacks = bitboard.getRookAttacks(square);
-
-        attacksByPiece[WHITE_ROOK] |= attacks;
-        attackedBy2[WHITE] |= (attacks & attacksByColor[WHITE]);
-        attacksByColor[WHITE] |= attacks;
-        attacksFrom[square] |= attacks;
-    }
-
-    uint64_t whiteQueens = bitboard.getPieceBoard(WHITE_QUEEN);
-    while (whiteQueens) {
-        uint8_t square = popLsb(whiteQueens);
-        uint64_t attacks = bitboard.getQueenAttacks(square);
-
-        attacksByPiece[WHITE_QUEEN] |= attacks;
-        attackedBy2[WHITE] |= (attacks & attacksByColor[WHITE]);
-        attacksByColor[WHITE] |= attacks;
-        attacksFrom[square] |= attacks;
-    }
-
-    {
-        uint64_t whiteKing = bitboard.getPieceBoard(WHITE_KING);
-        uint8_t square = popLsb(whiteKing);
-        uint64_t attacks = getKingAttacks(square);
-
-        attacksByPiece[WHITE_KING] |= attacks;
-        attacksByColor[WHITE] |= attacks;
-        attacksFrom[square] |= attacks;
-    }
-
-    uint64_t blackPawns = bitboard.getPieceBoard(BLACK_PAWN);
-    while (blackPawns) {
-        uint8_t square = popLsb(blackPawns);
-        uint64_t attacks = getPawnAttacks<BLACK>(square);
-
-        attacksByPiece[BLACK_PAWN] |= attacks;
-        attackedBy2[BLACK] |= (attacks & attacksByColor[BLACK]);
-        attacksByColor[BLACK] |= attacks;
-        attacksFrom[square] |= attacks;
-    }
-
-    uint64_t blackKnights = bitboard.getPieceBoard(BLACK_KNIGHT);
-    while (blackKnights) {
-        uint8_t square = popLsb(blackKnights);
-        uint64_t attacks = getKnightAttacks(square);
-
-        attacksByPiece[BLACK_KNIGHT] |= attacks;
-        attackedBy2[BLACK] |= (attacks & attacksByColor[BLACK]);
-        attacksByColor[BLACK] |= attacks;
-        attacksFrom[square] |= attacks;
-    }
-
-    uint64_t blackBishops = bitboard.getPieceBoard(BLACK_BISHOP);
-    while (blackBishops) {
-        uint8_t square = popLsb(blackBishops);
-        uint64_t attacks = bitboard.getBishopAttacks(square);
-
-        attacksByPiece[BLACK_BISHOP] |= attacks;
-        attackedBy2[BLACK] |= (attacks & attacksByColor[BLACK]);
-        attacksByColor[BLACK] |= attacks;
-        attacksFrom[square] |= attacks;
-    }
-
-    uint64_t blackRooks = bitboard.getPieceBoard(BLACK_ROOK);
-    while (blackRooks) {
-        uint8_t square = popLsb(blackRooks);
-        uint64_t attacks = bitboard.getRookAttacks(square);
-
-        attacksByPiece[BLACK_ROOK] |= attacks;
-        attackedBy2[BLACK] |= (attacks & attacksByColor[BLACK]);
-        attacksByColor[BLACK] |= attacks;
-        attacksFrom[square] |= attacks;
+template <typename Trace>
+template <PieceType pieceType>
+uint64_t Evaluation<Trace>::getPieceAttacks(uint8_t square) {
+    if constexpr (pieceType == WHITE_PAWN) {
+        return getPawnAttacks<WHITE>(square);
+    } else if constexpr (pieceType == BLACK_PAWN) {
+        return getPawnAttacks<BLACK>(square);
+    } else if constexpr (pieceType == WHITE_KNIGHT || pieceType == BLACK_KNIGHT) {
+        return getKnightAttacks(square);
+    } else if constexpr (pieceType == WHITE_BISHOP || pieceType == BLACK_BISHOP) {
+        return bitboard.getBishopAttacks(square);
+    } else if constexpr (pieceType == WHITE_ROOK || pieceType == BLACK_ROOK) {
+        return bitboard.getRookAttacks(square);
+    } else if constexpr (pieceType == WHITE_QUEEN || pieceType == BLACK_QUEEN) {
+        return bitboard.getQueenAttacks(square);
+    } else {
+        return getKingAttacks(square);
     }
+}
 
-    uint64_t blackQueens = bitboard.getPieceBoard(BLACK_QUEEN);
-    while (blackQueens) {
-        uint8_t square = popLsb(blackQueens);
-        uint64_t attacks = bitboard.getQueenAttacks(square);
+template <typename Trace>
+template <PieceType pieceType>
+void Evaluation<Trace>::initPieceAttacks() {
+    constexpr PieceColor color = pieceType % 2 == 0 ? WHITE : BLACK;
+    uint64_t pieces = bitboard.getPieceBoard(pieceType);
 
-        attacksByPiece[BLACK_QUEEN] |= attacks;
-        attackedBy2[BLACK] |= (attacks & attacksByColor[BLACK]);
-        attacksByColor[BLACK] |= attacks;
-        attacksFrom[square] |= attacks;
-    }
+    while (pieces) {
+        uint8_t square = popLsb(pieces);
+        uint64_t attacks = getPieceAttacks<pieceType>(square);
 
-    {
-        uint64_t blackKing = bitboard.getPieceBoard(BLACK_KING);
-        uint8_t square = popLsb(blackKing);
-        uint64_t attacks = getKingAttacks(square);
+        // The king is not included in attackedBy2
+        if constexpr (pieceType != WHITE_KING && pieceType != BLACK_KING) {
+            attackedBy2[color] |= (attacks & attacksByColor[color]);
+        }
 
-        attacksByPiece[BLACK_KING] |= attacks;
-        attacksByColor[BLACK] |= attacks;
-        attacksFrom[square] |= attacks;
+        attacksFrom[square] = attacks;
+        attacksByPiece[pieceType] |= attacks;
+        attacksByColor[color] |= attacks;
     }
 }
 
@@ -163,7 +71,8 @@ constexpr int rookPhase = 2;
 constexpr int queenPhase = 4;
 constexpr int totalPhase = knightPhase * 4 + bishopPhase * 4 + rookPhase * 4 + queenPhase * 2;
 
-int Evaluation::getPhase() {
+template <typename Trace>
+int Evaluation<Trace>::getPhase() {
     int phase = totalPhase;
 
     phase -= (bitboard.getMaterialCount<WHITE_KNIGHT>() + bitboard.getMaterialCount<BLACK_KNIGHT>())
@@ -178,350 +87,233 @@ int Evaluation::getPhase() {
     return (phase * 256 + (totalPhase / 2)) / totalPhase;
 }
 
-void Evaluation::addMobilityScoreForPiece(PieceType pieceType, int mobility) {
-    switch (pieceType) {
-        case WHITE_KNIGHT:
-            whiteMidgameScore += mobility * getEvalValue(MIDGAME_KNIGHT_MOBILITY);
-            whiteEndgameScore += mobility * getEvalValue(ENDGAME_KNIGHT_MOBILITY);
-            break;
-        case BLACK_KNIGHT:
-            blackMidgameScore += mobility * getEvalValue(MIDGAME_KNIGHT_MOBILITY);
-            blackEndgameScore += mobility * getEvalValue(ENDGAME_KNIGHT_MOBILITY);
-            break;
-        case WHITE_BISHOP:
-            whiteMidgameScore += mobility * getEvalValue(MIDGAME_BISHOP_MOBILITY);
-            whiteEndgameScore += mobility * getEvalValue(ENDGAME_BISHOP_MOBILITY);
-            break;
-        case BLACK_BISHOP:
-            blackMidgameScore += mobility * getEvalValue(MIDGAME_BISHOP_MOBILITY);
-            blackEndgameScore += mobility * getEvalValue(ENDGAME_BISHOP_MOBILITY);
-            break;
-        case WHITE_ROOK:
-            whiteMidgameScore += mobility * getEvalValue(MIDGAME_ROOK_MOBILITY);
-            whiteEndgameScore += mobility * getEvalValue(ENDGAME_ROOK_MOBILITY);
-            break;
-        case BLACK_ROOK:
-            blackMidgameScore += mobility * getEvalValue(MIDGAME_ROOK_MOBILITY);
-            blackEndgameScore += mobility * getEvalValue(ENDGAME_ROOK_MOBILITY);
-            break;
-        case WHITE_QUEEN:
-            whiteMidgameScore += mobility * getEvalValue(MIDGAME_QUEEN_MOBILITY);
-            whiteEndgameScore += mobility * getEvalValue(ENDGAME_QUEEN_MOBILITY);
-            break;
-        case BLACK_QUEEN:
-            blackMidgameScore += mobility * getEvalValue(MIDGAME_QUEEN_MOBILITY);
-            blackEndgameScore += mobility * getEvalValue(ENDGAME_QUEEN_MOBILITY);
-            break;
+template <typename Trace>
+template <PieceColor color>
+void Evaluation<Trace>::addScore(EvalFeature midgameFeature, EvalFeature endgameFeature,
+                                 int count) {
+    midgameScore[color] += count * getEvalValue(midgameFeature);
+    endgameScore[color] += count * getEvalValue(endgameFeature);
+
+    if constexpr (Trace::ENABLED) {
+        trace.add(color, midgameFeature, count);
+        trace.add(color, endgameFeature, count);
+    }
+}
+
+// Pawn scores go into the pawn entry instead, so they can be cached
+template <typename Trace>
+template <PieceColor color>
+void Evaluation<Trace>::addPawnScore(PawnEntry& entry, EvalFeature midgameFeature,
+                                     EvalFeature endgameFeature) {
+    entry.midgameScore[color] += getEvalValue(midgameFeature);
+    entry.endgameScore[color] += getEvalValue(endgameFeature);
+
+    if constexpr (Trace::ENABLED) {
+        trace.add(color, midgameFeature, 1);
+        trace.add(color, endgameFeature, 1);
     }
 }
 
-void Evaluation::addKingAttackScore(PieceType pieceType, int attackCount) {
-    switch (pieceType) {
-        case WHITE_PAWN:
-            blackMidgameScore += attackCount * getEvalValue(MIDGAME_KING_ATTACK_PAWN_PENALTY);
-            blackEndgameScore += attackCount * getEvalValue(ENDGAME_KING_ATTACK_PAWN_PENALTY);
-            break;
-        case BLACK_PAWN:
-            whiteMidgameScore += attackCount * getEvalValue(MIDGAME_KING_ATTACK_PAWN_PENALTY);
-            whiteEndgameScore += attackCount * getEvalValue(ENDGAME_KING_ATTACK_PAWN_PENALTY);
-            break;
-        case WHITE_KNIGHT:
-            blackMidgameScore += attackCount * getEvalValue(MIDGAME_KING_ATTACK_KNIGHT_PENALTY);
-            blackEndgameScore += attackCount * getEvalValue(ENDGAME_KING_ATTACK_KNIGHT_PENALTY);
-            break;
-        case BLACK_KNIGHT:
-            whiteMidgameScore += attackCount * getEvalValue(MIDGAME_KING_ATTACK_KNIGHT_PENALTY);
-            whiteEndgameScore += attackCount * getEvalValue(ENDGAME_KING_ATTACK_KNIGHT_PENALTY);
-            break;
-        case WHITE_BISHOP:
-            blackMidgameScore += attackCount * getEvalValue(MIDGAME_KING_ATTACK_BISHOP_PENALTY);
-            blackEndgameScore += attackCount * getEvalValue(ENDGAME_KING_ATTACK_BISHOP_PENALTY);
-            break;
-        case BLACK_BISHOP:
-            whiteMidgameScore += attackCount * getEvalValue(MIDGAME_KING_ATTACK_BISHOP_PENALTY);
-            whiteEndgameScore += attackCount * getEvalValue(ENDGAME_KING_ATTACK_BISHOP_PENALTY);
-            break;
-        case WHITE_ROOK:
-            blackMidgameScore += attackCount * getEvalValue(MIDGAME_KING_ATTACK_ROOK_PENALTY);
-            blackEndgameScore += attackCount * getEvalValue(ENDGAME_KING_ATTACK_ROOK_PENALTY);
-            break;
-        case BLACK_ROOK:
-            whiteMidgameScore += attackCount * getEvalValue(MIDGAME_KING_ATTACK_ROOK_PENALTY);
-            whiteEndgameScore += attackCount * getEvalValue(ENDGAME_KING_ATTACK_ROOK_PENALTY);
-            break;
-        case WHITE_QUEEN:
-            blackMidgameScore += attackCount * getEvalValue(MIDGAME_KING_ATTACK_QUEEN_PENALTY);
-            blackEndgameScore += attackCount * getEvalValue(ENDGAME_KING_ATTACK_QUEEN_PENALTY);
-            break;
-        case BLACK_QUEEN:
-            whiteMidgameScore += attackCount * getEvalValue(MIDGAME_KING_ATTACK_QUEEN_PENALTY);
-            whiteEndgameScore += attackCount * getEvalValue(ENDGAME_KING_ATTACK_QUEEN_PENALTY);
-            break;
+template <typename Trace>
+void Evaluation<Trace>::evaluatePawnStructure() {
+    uint64_t pawnHash = bitboard.getPawnHash();
+    PawnEntry localEntry{};
+    PawnEntry* entry = &localEntry;
+
+    // A cached entry has no trace, so the tuner always evaluates the pawns itself
+    if (pawnTable != nullptr && !Trace::ENABLED) {
+        entry = pawnTable->getEntry(pawnHash);
+    }
+
+    if (entry == &localEntry || entry->pawnHash != pawnHash) {
+        *entry = {};
+        entry->pawnHash = pawnHash;
+        evaluatePawns<WHITE>(*entry);
+        evaluatePawns<BLACK>(*entry);
+    }
+
+    for (PieceColor color : {WHITE, BLACK}) {
+        midgameScore[color] += entry->midgameScore[color];
+        endgameScore[color] += entry->endgameScore[color];
+        passedPawns[color] = entry->passedPawns[color];
     }
 }
 
+template <typename Trace>
 template <PieceColor color>
-void Evaluation::evaluatePieces() {
-    uint64_t colorBoard = bitboard.getColorBoard<color>();
-    int8_t blackKingSquare = bitscanForward(bitboard.getPieceBoard(BLACK_KING));
-    int8_t whiteKingSquare = bitscanForward(bitboard.getPieceBoard(WHITE_KING));
-    uint64_t blackKingAttacks = attacksFrom[blackKingSquare];
-    uint64_t whiteKingAttacks = attacksFrom[whiteKingSquare];
+void Evaluation<Trace>::evaluatePawns(PawnEntry& entry) {
+    uint64_t pawnBB = bitboard.getPieceBoard(color == WHITE ? WHITE_PAWN : BLACK_PAWN);
+    uint64_t pawns = pawnBB;
 
-    while (colorBoard) {
-        uint8_t index = popLsb(colorBoard);
-        PieceType pieceType = bitboard.getPieceOnSquare(index);
+    while (pawns) {
+        uint8_t index = popLsb(pawns);
 
-        // Mobility
-        if (isNotPawnOrKing(pieceType)) {
-            uint64_t mobilitySquares = attacksFrom[index];
+        // Doubled pawn
+        Direction direction = color == WHITE ? NORTH : SOUTH;
+        uint64_t frontMask = getRayAttack(index, direction);
+        uint64_t doubledPawns = pawnBB & frontMask;
 
-            if (color == WHITE) {
-                uint64_t weakSquares = attackedBy2[BLACK] & ~attackedBy2[WHITE];
+        if (doubledPawns) {
+            addPawnScore<color>(entry, MIDGAME_DOUBLED_PAWN_PENALTY, ENDGAME_DOUBLED_PAWN_PENALTY);
+        }
 
-                // Exclude own pieces and attacks by opponent pawns
-                mobilitySquares &= ~(bitboard.getColorBoard<WHITE>() | attacksByPiece[BLACK_PAWN]);
+        // Passed pawn
+        if (bitboard.isPassedPawn<color>(index)) {
+            entry.passedPawns[color] |= 1ULL << index;
+            addPawnScore<color>(entry, MIDGAME_PASSED_PAWN, ENDGAME_PASSED_PAWN);
+        }
 
-                // If pieceType == queen, exclude tiles attacked by opponent bishop, knight and rook
-                if (pieceType == WHITE_QUEEN) {
-                    mobilitySquares &= ~(
-                        attacksByPiece[BLACK_BISHOP] | attacksByPiece[BLACK_KNIGHT] |
-                        attacksByPiece[BLACK_ROOK]);
-                }
+        // Isolated pawn
+        if (bitboard.isIsolatedPawn<color>(index)) {
+            addPawnScore<color>(entry, MIDGAME_ISOLATED_PAWN_PENALTY,
+                                ENDGAME_ISOLATED_PAWN_PENALTY);
 
-                // If pieceType == rook, exclude tiles attacked by opponent bishop and knight
-                if (pieceType == WHITE_ROOK) {
-                    mobilitySquares &= ~(
-                        attacksByPiece[BLACK_BISHOP] | attacksByPiece[BLACK_KNIGHT]);
-                }
+            if (bitboard.isSemiOpenFile<color>(index)) {
+                addPawnScore<color>(entry, MIDGAME_ISOLATED_SEMI_OPEN_PAWN_PENALTY,
+                                    ENDGAME_ISOLATED_SEMI_OPEN_PAWN_PENALTY);
+            }
 
-                mobilitySquares &= ~weakSquares;
-            } else {
-                uint64_t weakSquares = attackedBy2[WHITE] & ~attackedBy2[BLACK];
+            if ((1ULL << index) & DE_FILE) {
+                addPawnScore<color>(entry, MIDGAME_ISOLATED_CENTRAL_PAWN_PENALTY,
+                                    ENDGAME_ISOLATED_CENTRAL_PAWN_PENALTY);
+            }
+        }
+    }
+}
 
-                // Exclude own pieces and attacks by opponent pawns
-                mobilitySquares &= ~(bitboard.getColorBoard<BLACK>() | attacksByPiece[WHITE_PAWN]);
+template <typename Trace>
+template <PieceColor color>
+void Evaluation<Trace>::evaluatePieces() {
+    constexpr PieceColor OPPOSITE_COLOR = color == WHITE ? BLACK : WHITE;
+    constexpr PieceType ownPawn = color == WHITE ? WHITE_PAWN : BLACK_PAWN;
+    constexpr PieceType ownBishop = color == WHITE ? WHITE_BISHOP : BLACK_BISHOP;
+    constexpr PieceType ownRook = color == WHITE ? WHITE_ROOK : BLACK_ROOK;
+    constexpr PieceType opponentPawn = color == WHITE ? BLACK_PAWN : WHITE_PAWN;
+    constexpr PieceType opponentKnight = color == WHITE ? BLACK_KNIGHT : WHITE_KNIGHT;
+    constexpr PieceType opponentBishop = color == WHITE ? BLACK_BISHOP : WHITE_BISHOP;
+    constexpr PieceType opponentRook = color == WHITE ? BLACK_ROOK : WHITE_ROOK;
+    constexpr PieceType opponentQueen = color == WHITE ? BLACK_QUEEN : WHITE_QUEEN;
+    constexpr PieceType opponentKing = color == WHITE ? BLACK_KING : WHITE_KING;
 
-                // If pieceType == queen, exclude tiles attacked by opponent bishop, knight and rook
-                if (pieceType == BLACK_QUEEN) {
-                    mobilitySquares &= ~(
-                        attacksByPiece[WHITE_BISHOP] | attacksByPiece[WHITE_KNIGHT] |
-                        attacksByPiece[WHITE_ROOK]);
-                }
+    uint64_t colorBoard = bitboard.getColorBoard<color>();
+    uint64_t ownPawns = bitboard.getPieceBoard(ownPawn);
+    uint64_t opponentKingAttacks = attacksByPiece[opponentKing];
+    uint64_t weakSquares = attackedBy2[OPPOSITE_COLOR] & ~attackedBy2[color];
 
-                // If pieceType == rook, exclude tiles attacked by opponent bishop and knight
-                if (pieceType == BLACK_ROOK) {
-                    mobilitySquares &= ~(
-                        attacksByPiece[WHITE_BISHOP] | attacksByPiece[WHITE_KNIGHT]);
-                }
+    while (colorBoard) {
+        uint8_t index = popLsb(colorBoard);
+        PieceType pieceType = bitboard.getPieceOnSquare(index);
+        uint64_t attacks = attacksFrom[index];
+
+        // Mobility
+        if (isNotPawnOrKing(pieceType)) {
+            // Exclude own pieces and attacks by opponent pawns
+            uint64_t mobilitySquares =
+                attacks & ~(bitboard.getColorBoard<color>() | attacksByPiece[opponentPawn]);
+
+            // If pieceType == queen, exclude tiles attacked by opponent bishop, knight and rook
+            if (isQueen(pieceType)) {
+                mobilitySquares &= ~(attacksByPiece[opponentBishop] | attacksByPiece[opponentKnight]
+                                     | attacksByPiece[opponentRook]);
+            }
 
-                mobilitySquares &= ~weakSquares;
+            // If pieceType == rook, exclude tiles attacked by opponent bishop and knight
+            if (isRook(pieceType)) {
+                mobilitySquares &=
+                    ~(attacksByPiece[opponentBishop] | attacksByPiece[opponentKnight]);
             }
 
-            uint8_t mobility = popcnt(mobilitySquares);
-            addMobilityScoreForPiece(pieceType, mobility);
+            mobilitySquares &= ~weakSquares;
+
+            // The mobility features are ordered by piece type, starting at the knight
+            auto feature =
+                static_cast<EvalFeature>(MIDGAME_KNIGHT_MOBILITY + (pieceType / 2 - 1) * 2);
+            addScore<color>(feature, static_cast<EvalFeature>(feature + 1),
+                            popcnt(mobilitySquares));
         }
 
         // King safety - Attacks around king
         if (!isKing(pieceType)) {
-            uint64_t attackSquares = attacksFrom[index];
-            uint64_t opponentKingAttacks = color == WHITE ? blackKingAttacks : whiteKingAttacks;
-            uint64_t attacksAroundKing = attackSquares & opponentKingAttacks;
-            uint8_t attackCount = popcnt(attacksAroundKing);
+            uint64_t attacksAroundKing = attacks & opponentKingAttacks;
+            // The king attack features are ordered by piece type, starting at the pawn
+            auto feature =
+                static_cast<EvalFeature>(MIDGAME_KING_ATTACK_PAWN_PENALTY + (pieceType / 2) * 2);
 
-            addKingAttackScore(pieceType, attackCount);
+            addScore<OPPOSITE_COLOR>(feature, static_cast<EvalFeature>(feature + 1),
+                                     popcnt(attacksAroundKing));
         }
 
         // Other King safety
         if (isKing(pieceType)) {
+            // Pawn Shield
+            uint64_t kingBB = 1ULL << index;
+            uint64_t pawnShieldMask;
+
             if (color == WHITE) {
-                // Pawn Shield
-                uint64_t kingBB = bitboard.getPieceBoard(WHITE_KING);
-                uint64_t pawnBB = bitboard.getPieceBoard(WHITE_PAWN);
-                uint64_t pawnShieldMask = nortOne(kingBB) | noEaOne(kingBB) | noWeOne(kingBB);
+                pawnShieldMask = nortOne(kingBB) | noEaOne(kingBB) | noWeOne(kingBB);
                 pawnShieldMask |= nortOne(pawnShieldMask);
-                uint64_t pawnShield = pawnBB & pawnShieldMask;
-                uint8_t pawnShieldCount = std::min<uint64_t>(popcnt(pawnShield), 3ULL);
-
-                whiteMidgameScore += getEvalValue(MIDGAME_PAWN_SHIELD) * pawnShieldCount;
-                whiteEndgameScore += getEvalValue(ENDGAME_PAWN_SHIELD) * pawnShieldCount;
-
-                // Virtual mobility - Get queen attacks from king position, with only occupied squares by
-                // own pieces. We also ignore the squares around the king.
-                uint64_t virtualMobilitySquares =
-                    bitboard.getQueenAttacks(index, bitboard.getColorBoard<WHITE>()) &
-                    ~(attacksFrom[index] | bitboard.getColorBoard<WHITE>());
-                whiteMidgameScore +=
-                    popcnt(virtualMobilitySquares) * getEvalValue(
-                        MIDGAME_KING_VIRTUAL_MOBILITY_PENALTY);
-                whiteEndgameScore +=
-                    popcnt(virtualMobilitySquares) * getEvalValue(
-                        ENDGAME_KING_VIRTUAL_MOBILITY_PENALTY);
             } else {
-                // Pawn Shield
-                uint64_t kingBB = bitboard.getPieceBoard(BLACK_KING);
-                uint64_t pawnBB = bitboard.getPieceBoard(BLACK_PAWN);
-                uint64_t pawnShieldMask = soutOne(kingBB) | soEaOne(kingBB) | soWeOne(kingBB);
+                pawnShieldMask = soutOne(kingBB) | soEaOne(kingBB) | soWeOne(kingBB);
                 pawnShieldMask |= soutOne(pawnShieldMask);
-                uint64_t pawnShield = pawnBB & pawnShieldMask;
-                uint8_t pawnShieldCount = std::min<uint64_t>(popcnt(pawnShield), 3ULL);
-
-                blackMidgameScore += getEvalValue(MIDGAME_PAWN_SHIELD) * pawnShieldCount;
-                blackEndgameScore += getEvalValue(ENDGAME_PAWN_SHIELD) * pawnShieldCount;
-
-                // Virtual mobility - Get queen attacks from king position, with only occupied squares by
-                // own pieces. We also ignore the squares around the king.
-                uint64_t virtualMobilitySquares =
-                    bitboard.getQueenAttacks(index, bitboard.getColorBoard<BLACK>()) &
-                    ~(attacksFrom[index] | bitboard.getColorBoard<BLACK>());
-                blackMidgameScore +=
-                    popcnt(virtualMobilitySquares) * getEvalValue(
-                        MIDGAME_KING_VIRTUAL_MOBILITY_PENALTY);
-                blackEndgameScore +=
-                    popcnt(virtualMobilitySquares) * getEvalValue(
-                        ENDGAME_KING_VIRTUAL_MOBILITY_PENALTY);
             }
+
+            uint64_t pawnShield = ownPawns & pawnShieldMask;
+            uint8_t pawnShieldCount = std::min<uint64_t>(popcnt(pawnShield), 3ULL);
+
+            addScore<color>(MIDGAME_PAWN_SHIELD, ENDGAME_PAWN_SHIELD, pawnShieldCount);
+
+            // Virtual mobility - Get queen attacks from king position, with only occupied squares
+            // by own pieces. We also ignore the squares around the king.
+            uint64_t virtualMobilitySquares =
+                bitboard.getQueenAttacks(index, bitboard.getColorBoard<color>()) &
+                ~(attacks | bitboard.getColorBoard<color>());
+
+            addScore<color>(MIDGAME_KING_VIRTUAL_MOBILITY_PENALTY,
+                            ENDGAME_KING_VIRTUAL_MOBILITY_PENALTY, popcnt(virtualMobilitySquares));
         }
 
-        // Per piece evaluation
-        if (isPawn(pieceType)) {
-            // Doubled pawn
-            uint64_t pawnBB = bitboard.getPieceBoard(pieceType);
+        // Tarrasch rule
+        if (isPawn(pieceType) && (passedPawns[color] & (1ULL << index))) {
             Direction direction = color == WHITE ? NORTH : SOUTH;
             Direction oppositeDirection = color == WHITE ? SOUTH : NORTH;
             uint64_t frontMask = getRayAttack(index, direction);
             uint64_t behindMask = getRayAttack(index, oppositeDirection);
-            uint64_t doubledPawns = pawnBB & frontMask;
-
-            if (doubledPawns) {
-                if (color == WHITE) {
-                    whiteMidgameScore += getEvalValue(MIDGAME_DOUBLED_PAWN_PENALTY);
-                    whiteEndgameScore += getEvalValue(ENDGAME_DOUBLED_PAWN_PENALTY);
-                } else {
-                    blackMidgameScore += getEvalValue(MIDGAME_DOUBLED_PAWN_PENALTY);
-                    blackEndgameScore += getEvalValue(ENDGAME_DOUBLED_PAWN_PENALTY);
-                }
-            }
-
-            // Passed pawn
-            if (bitboard.isPassedPawn<color>(index)) {
-                if (color == WHITE) {
-                    whiteMidgameScore += getEvalValue(MIDGAME_PASSED_PAWN);
-                    whiteEndgameScore += getEvalValue(ENDGAME_PASSED_PAWN);
-                } else {
-                    blackMidgameScore += getEvalValue(MIDGAME_PASSED_PAWN);
-                    blackEndgameScore += getEvalValue(ENDGAME_PASSED_PAWN);
-                }
-
-                // Tarrasch rule
-                if (color == WHITE) {
-                    // Rook in front of own passed pawn penalty
-                    if (frontMask & bitboard.getPieceBoard(WHITE_ROOK)) {
-                        whiteMidgameScore += getEvalValue(MIDGAME_TARRASCH_OWN_ROOK_PENALTY);
-                        whiteEndgameScore += getEvalValue(ENDGAME_TARRASCH_OWN_ROOK_PENALTY);
-                    }
-
-                    // Rook behind own passed pawn bonus
-                    if (behindMask & bitboard.getPieceBoard(WHITE_ROOK)) {
-                        whiteMidgameScore += getEvalValue(MIDGAME_TARRASCH_OWN_ROOK_DEFEND);
-                        whiteEndgameScore += getEvalValue(ENDGAME_TARRASCH_OWN_ROOK_DEFEND);
-                    }
 
-                    // Opponent rook behind own passed pawn penalty
-                    if (behindMask & bitboard.getPieceBoard(BLACK_ROOK)) {
-                        whiteMidgameScore += getEvalValue(MIDGAME_TARRASCH_OPPONENT_ROOK_PENALTY);
-                        whiteEndgameScore += getEvalValue(ENDGAME_TARRASCH_OPPONENT_ROOK_PENALTY);
-                    }
-                } else {
-                    // Rook in front of own passed pawn penalty
-                    if (frontMask & bitboard.getPieceBoard(BLACK_ROOK)) {
-                        blackMidgameScore += getEvalValue(MIDGAME_TARRASCH_OWN_ROOK_PENALTY);
-                        blackEndgameScore += getEvalValue(ENDGAME_TARRASCH_OWN_ROOK_PENALTY);
-                    }
-
-                    // Rook behind own passed pawn bonus
-                    if (behindMask & bitboard.getPieceBoard(BLACK_ROOK)) {
-                        blackMidgameScore += getEvalValue(MIDGAME_TARRASCH_OWN_ROOK_DEFEND);
-                        blackEndgameScore += getEvalValue(ENDGAME_TARRASCH_OWN_ROOK_DEFEND);
-                    }
-
-                    // Opponent rook behind own passed pawn penalty
-                    if (behindMask & bitboard.getPieceBoard(WHITE_ROOK)) {
-                        blackMidgameScore += getEvalValue(MIDGAME_TARRASCH_OPPONENT_ROOK_PENALTY);
-                        blackEndgameScore += getEvalValue(ENDGAME_TARRASCH_OPPONENT_ROOK_PENALTY);
-                    }
-                }
+            // Rook in front of own passed pawn penalty
+            if (frontMask & bitboard.getPieceBoard(ownRook)) {
+                addScore<color>(MIDGAME_TARRASCH_OWN_ROOK_PENALTY,
+                                ENDGAME_TARRASCH_OWN_ROOK_PENALTY);
             }
 
-            // Isolated pawn
-            if (bitboard.isIsolatedPawn<color>(index)) {
-                if (color == WHITE) {
-                    whiteMidgameScore += getEvalValue(MIDGAME_ISOLATED_PAWN_PENALTY);
-                    whiteEndgameScore += getEvalValue(ENDGAME_ISOLATED_PAWN_PENALTY);
-                } else {
-                    blackMidgameScore += getEvalValue(MIDGAME_ISOLATED_PAWN_PENALTY);
-                    blackEndgameScore += getEvalValue(ENDGAME_ISOLATED_PAWN_PENALTY);
-                }
-
-                if (bitboard.isSemiOpenFile<color>(index)) {
-                    if (color == WHITE) {
-                        whiteMidgameScore += getEvalValue(MIDGAME_ISOLATED_SEMI_OPEN_PAWN_PENALTY);
-                        whiteEndgameScore += getEvalValue(ENDGAME_ISOLATED_SEMI_OPEN_PAWN_PENALTY);
-                    } else {
-                        blackMidgameScore += getEvalValue(MIDGAME_ISOLATED_SEMI_OPEN_PAWN_PENALTY);
-                        blackEndgameScore += getEvalValue(ENDGAME_ISOLATED_SEMI_OPEN_PAWN_PENALTY);
-                    }
-                }
+            // Rook behind own passed pawn bonus
+            if (behindMask & bitboard.getPieceBoard(ownRook)) {
+                addScore<color>(MIDGAME_TARRASCH_OWN_ROOK_DEFEND, ENDGAME_TARRASCH_OWN_ROOK_DEFEND);
+            }
 
-                if ((1ULL << index) & DE_FILE) {
-                    if (color == WHITE) {
-                        whiteMidgameScore += getEvalValue(MIDGAME_ISOLATED_CENTRAL_PAWN_PENALTY);
-                        whiteEndgameScore += getEvalValue(ENDGAME_ISOLATED_CENTRAL_PAWN_PENALTY);
-                    } else {
-                        blackMidgameScore += getEvalValue(MIDGAME_ISOLATED_CENTRAL_PAWN_PENALTY);
-                        blackEndgameScore += getEvalValue(ENDGAME_ISOLATED_CENTRAL_PAWN_PENALTY);
-                    }
-                }
+            // Opponent rook behind own passed pawn penalty
+            if (behindMask & bitboard.getPieceBoard(opponentRook)) {
+                addScore<color>(MIDGAME_TARRASCH_OPPONENT_ROOK_PENALTY,
+                                ENDGAME_TARRASCH_OPPONENT_ROOK_PENALTY);
             }
         }
 
         // Knight eval
         if (isKnight(pieceType)) {
             // Penalize the knight's value for each missing pawn
-            uint64_t pawnBB = bitboard.getPieceBoard(color == WHITE ? WHITE_PAWN : BLACK_PAWN);
-            uint8_t pawnCount = popcnt(pawnBB);
+            uint8_t pawnCount = popcnt(ownPawns);
 
-            if (color == WHITE) {
-                whiteMidgameScore += getEvalValue(MIDGAME_KNIGHT_MISSING_PAWN_PENALTY) * (
-                    8 - pawnCount);
-                whiteEndgameScore += getEvalValue(ENDGAME_KNIGHT_MISSING_PAWN_PENALTY) * (
-                    8 - pawnCount);
-            } else {
-                blackMidgameScore += getEvalValue(MIDGAME_KNIGHT_MISSING_PAWN_PENALTY) * (
-                    8 - pawnCount);
-                blackEndgameScore += getEvalValue(ENDGAME_KNIGHT_MISSING_PAWN_PENALTY) * (
-                    8 - pawnCount);
-            }
+            addScore<color>(MIDGAME_KNIGHT_MISSING_PAWN_PENALTY,
+                            ENDGAME_KNIGHT_MISSING_PAWN_PENALTY, 8 - pawnCount);
 
             // Slight bonus for knights defended by a pawn
-            uint64_t pawnAttacks = attacksByPiece[color == WHITE ? WHITE_PAWN : BLACK_PAWN];
-
-            if ((1ULL << index) & pawnAttacks) {
-                if (color == WHITE) {
-                    whiteMidgameScore += getEvalValue(MIDGAME_KNIGHT_DEFENDED_BY_PAWN);
-                    whiteEndgameScore += getEvalValue(ENDGAME_KNIGHT_DEFENDED_BY_PAWN);
-                } else {
-                    blackMidgameScore += getEvalValue(MIDGAME_KNIGHT_DEFENDED_BY_PAWN);
-                    blackEndgameScore += getEvalValue(ENDGAME_KNIGHT_DEFENDED_BY_PAWN);
-                }
+            if ((1ULL << index) & attacksByPiece[ownPawn]) {
+                addScore<color>(MIDGAME_KNIGHT_DEFENDED_BY_PAWN, ENDGAME_KNIGHT_DEFENDED_BY_PAWN);
             }
         }
 
         // Bishop eval
         if (isBishop(pieceType)) {
             // Bad bishop
-            uint64_t bishopAttacks = attacksFrom[index];
-            uint64_t pawnBB = bitboard.getPieceBoard(color == WHITE ? WHITE_PAWN : BLACK_PAWN);
             uint64_t forwardMobility;
 
             if (color == WHITE) {
@@ -530,36 +322,23 @@ void Evaluation::evaluatePieces() {
                 forwardMobility = getRayAttack(index, SOUTH_WEST) | getRayAttack(index, SOUTH_EAST);
             }
 
-            bishopAttacks &= forwardMobility;
+            uint64_t bishopAttacks = attacks & forwardMobility;
 
             // If one of our own pawns is on the same diagonal as the bishop and the bishop has <= 3
             // squares of mobility, it's a bad bishop
-            if (bishopAttacks & pawnBB) {
-                uint64_t bishopAttacksWithoutPawns = bishopAttacks & ~pawnBB;
+            if (bishopAttacks & ownPawns) {
+                uint64_t bishopAttacksWithoutPawns = bishopAttacks & ~ownPawns;
                 uint64_t attackCount = popcnt(bishopAttacksWithoutPawns);
 
                 if (attackCount <= 3) {
-                    if (color == WHITE) {
-                        whiteMidgameScore += getEvalValue(MIDGAME_BAD_BISHOP_PENALTY);
-                        whiteEndgameScore += getEvalValue(ENDGAME_BAD_BISHOP_PENALTY);
-                    } else {
-                        blackMidgameScore += getEvalValue(MIDGAME_BAD_BISHOP_PENALTY);
-                        blackEndgameScore += getEvalValue(ENDGAME_BAD_BISHOP_PENALTY);
-                    }
+                    addScore<color>(MIDGAME_BAD_BISHOP_PENALTY, ENDGAME_BAD_BISHOP_PENALTY);
                 }
             }
 
             // Only one bishop (no bishop pair)
-            if (color == WHITE) {
-                if (bitboard.getMaterialCount<WHITE_BISHOP>() == 1) {
-                    whiteMidgameScore += getEvalValue(MIDGAME_MISSING_BISHOP_PAIR_PENALTY);
-                    whiteEndgameScore += getEvalValue(ENDGAME_MISSING_BISHOP_PAIR_PENALTY);
-                }
-            } else {
-                if (bitboard.getMaterialCount<BLACK_BISHOP>() == 1) {
-                    blackMidgameScore += getEvalValue(MIDGAME_MISSING_BISHOP_PAIR_PENALTY);
-                    blackEndgameScore += getEvalValue(ENDGAME_MISSING_BISHOP_PAIR_PENALTY);
-                }
+            if (bitboard.getMaterialCount<ownBishop>() == 1) {
+                addScore<color>(MIDGAME_MISSING_BISHOP_PAIR_PENALTY,
+                                ENDGAME_MISSING_BISHOP_PAIR_PENALTY);
             }
 
             // Fianchetto
@@ -569,9 +348,8 @@ void Evaluation::evaluatePieces() {
                         nortOne(1ULL << index) | westOne(1ULL << index) | eastOne(1ULL << index);
                     uint64_t antiPattern = noWeOne(1ULL << index) | noEaOne(1ULL << index);
 
-                    if (popcnt(pawnBB & fianchettoPattern) == 3 && !(pawnBB & antiPattern)) {
-                        whiteMidgameScore += getEvalValue(MIDGAME_BISHOP_FIANCHETTO);
-                        whiteEndgameScore += getEvalValue(ENDGAME_BISHOP_FIANCHETTO);
+                    if (popcnt(ownPawns & fianchettoPattern) == 3 && !(ownPawns & antiPattern)) {
+                        addScore<color>(MIDGAME_BISHOP_FIANCHETTO, ENDGAME_BISHOP_FIANCHETTO);
                     }
                 }
             } else {
@@ -580,9 +358,8 @@ void Evaluation::evaluatePieces() {
                         soutOne(1ULL << index) | westOne(1ULL << index) | eastOne(1ULL << index);
                     uint64_t antiPattern = soWeOne(1ULL << index) | soEaOne(1ULL << index);
 
-                    if (popcnt(pawnBB & fianchettoPattern) == 3 && !(pawnBB & antiPattern)) {
-                        blackMidgameScore += getEvalValue(MIDGAME_BISHOP_FIANCHETTO);
-                        blackEndgameScore += getEvalValue(ENDGAME_BISHOP_FIANCHETTO);
+                    if (popcnt(ownPawns & fianchettoPattern) == 3 && !(ownPawns & antiPattern)) {
+                        addScore<color>(MIDGAME_BISHOP_FIANCHETTO, ENDGAME_BISHOP_FIANCHETTO);
                     }
                 }
             }
@@ -591,104 +368,63 @@ void Evaluation::evaluatePieces() {
         // Rook eval
         if (isRook(pieceType)) {
             // Increase in value as pawns disappear
-            uint64_t pawnBB = bitboard.getPieceBoard(color == WHITE ? WHITE_PAWN : BLACK_PAWN);
-            uint8_t pawnCount = popcnt(pawnBB);
+            uint8_t pawnCount = popcnt(ownPawns);
 
-            if (color == WHITE) {
-                whiteMidgameScore += getEvalValue(MIDGAME_ROOK_PAWN_COUNT) * (8 - pawnCount);
-                whiteEndgameScore += getEvalValue(ENDGAME_ROOK_PAWN_COUNT) * (8 - pawnCount);
-            } else {
-                blackMidgameScore += getEvalValue(MIDGAME_ROOK_PAWN_COUNT) * (8 - pawnCount);
-                blackEndgameScore += getEvalValue(ENDGAME_ROOK_PAWN_COUNT) * (8 - pawnCount);
-            }
+            addScore<color>(MIDGAME_ROOK_PAWN_COUNT, ENDGAME_ROOK_PAWN_COUNT, 8 - pawnCount);
 
             // Rook on open file
             if (bitboard.isOpenFile(index)) {
-                if (color == WHITE) {
-                    whiteMidgameScore += getEvalValue(MIDGAME_ROOK_ON_OPEN_FILE);
-                    whiteEndgameScore += getEvalValue(ENDGAME_ROOK_ON_OPEN_FILE);
-                } else {
-                    blackMidgameScore += getEvalValue(MIDGAME_ROOK_ON_OPEN_FILE);
-                    blackEndgameScore += getEvalValue(ENDGAME_ROOK_ON_OPEN_FILE);
-                }
+                addScore<color>(MIDGAME_ROOK_ON_OPEN_FILE, ENDGAME_ROOK_ON_OPEN_FILE);
             } else if (bitboard.isSemiOpenFile<color>(index)) {
-                if (color == WHITE) {
-                    whiteMidgameScore += getEvalValue(MIDGAME_ROOK_ON_SEMI_OPEN_FILE);
-                    whiteEndgameScore += getEvalValue(ENDGAME_ROOK_ON_SEMI_OPEN_FILE);
-                } else {
-                    blackMidgameScore += getEvalValue(MIDGAME_ROOK_ON_SEMI_OPEN_FILE);
-                    blackEndgameScore += getEvalValue(ENDGAME_ROOK_ON_SEMI_OPEN_FILE);
-                }
+                addScore<color>(MIDGAME_ROOK_ON_SEMI_OPEN_FILE, ENDGAME_ROOK_ON_SEMI_OPEN_FILE);
             }
 
             // Rook on 7th or 8th rank (or 2nd or 1st rank for black)
-            if (color == WHITE) {
-                if ((1ULL << index) & (RANK_8 | RANK_7)) {
-                    whiteMidgameScore += getEvalValue(MIDGAME_ROOK_ON_7TH_RANK);
-                    whiteEndgameScore += getEvalValue(ENDGAME_ROOK_ON_7TH_RANK);
-                }
-            } else {
-                if ((1ULL << index) & (RANK_1 | RANK_2)) {
-                    blackMidgameScore += getEvalValue(MIDGAME_ROOK_ON_7TH_RANK);
-                    blackEndgameScore += getEvalValue(ENDGAME_ROOK_ON_7TH_RANK);
-                }
-            }
+            uint64_t seventhRanks = color == WHITE ? (RANK_8 | RANK_7) : (RANK_1 | RANK_2);
 
-            uint64_t file = bitboard.getFile(index);
-            uint64_t opponentQueens = bitboard.getPieceBoard(
-                color == WHITE ? BLACK_QUEEN : WHITE_QUEEN);
+            if ((1ULL << index) & seventhRanks) {
+                addScore<color>(MIDGAME_ROOK_ON_7TH_RANK, ENDGAME_ROOK_ON_7TH_RANK);
+            }
 
             // Bonus for rook with enemy queen on same file
-            if (file & opponentQueens) {
-                if (color == WHITE) {
-                    whiteMidgameScore += getEvalValue(MIDGAME_ROOK_ON_QUEEN_FILE);
-                    whiteEndgameScore += getEvalValue(ENDGAME_ROOK_ON_QUEEN_FILE);
-                } else {
-                    blackMidgameScore += getEvalValue(MIDGAME_ROOK_ON_QUEEN_FILE);
-                    blackEndgameScore += getEvalValue(ENDGAME_ROOK_ON_QUEEN_FILE);
-                }
+            if (bitboard.getFile(index) & bitboard.getPieceBoard(opponentQueen)) {
+                addScore<color>(MIDGAME_ROOK_ON_QUEEN_FILE, ENDGAME_ROOK_ON_QUEEN_FILE);
             }
         }
 
         // Undefended minor pieces
         if (isKnight(pieceType) || isBishop(pieceType)) {
+            // Penalize a minor piece for not being defended
             if (!((1ULL << index) & attacksByColor[color])) {
-                // Penalize a minor piece for not being defended
-                if (color == WHITE) {
-                    whiteMidgameScore += getEvalValue(MIDGAME_MINOR_PIECE_NOT_DEFENDED_PENALTY);
-                    whiteEndgameScore += getEvalValue(ENDGAME_MINOR_PIECE_NOT_DEFENDED_PENALTY);
-                } else {
-                    blackMidgameScore += getEvalValue(MIDGAME_MINOR_PIECE_NOT_DEFENDED_PENALTY);
-                    blackEndgameScore += getEvalValue(ENDGAME_MINOR_PIECE_NOT_DEFENDED_PENALTY);
-                }
+                addScore<color>(MIDGAME_MINOR_PIECE_NOT_DEFENDED_PENALTY,
+                                ENDGAME_MINOR_PIECE_NOT_DEFENDED_PENALTY);
             }
 
-            uint64_t weakSquares;
-
-            if (color == WHITE) {
-                weakSquares = attackedBy2[BLACK] & ~attackedBy2[WHITE];
-
-                if ((1ULL << index) & weakSquares) {
-                    whiteMidgameScore += getEvalValue(MIDGAME_MINOR_PIECE_ON_WEAK_SQUARE_PENALTY);
-                    whiteEndgameScore += getEvalValue(ENDGAME_MINOR_PIECE_ON_WEAK_SQUARE_PENALTY);
-                }
-            } else {
-                weakSquares = attackedBy2[WHITE] & ~attackedBy2[BLACK];
-
-                if ((1ULL << index) & weakSquares) {
-                    blackMidgameScore += getEvalValue(MIDGAME_MINOR_PIECE_ON_WEAK_SQUARE_PENALTY);
-                    blackEndgameScore += getEvalValue(ENDGAME_MINOR_PIECE_ON_WEAK_SQUARE_PENALTY);
-                }
+            if ((1ULL << index) & weakSquares) {
+                addScore<color>(MIDGAME_MINOR_PIECE_ON_WEAK_SQUARE_PENALTY,
+                                ENDGAME_MINOR_PIECE_ON_WEAK_SQUARE_PENALTY);
             }
         }
     }
 }
 
-int Evaluation::evaluate() {
+template <typename Trace>
+int Evaluation<Trace>::evaluate() {
     int phase = getPhase();
     int modifier = bitboard.getMovingColor() == WHITE ? 1 : -1;
 
-    initEvalContext(bitboard);
+    initPieceAttacks<WHITE_PAWN>();
+    initPieceAttacks<WHITE_KNIGHT>();
+    initPieceAttacks<WHITE_BISHOP>();
+    initPieceAttacks<WHITE_ROOK>();
+    initPieceAttacks<WHITE_QUEEN>();
+    initPieceAttacks<WHITE_KING>();
+    initPieceAttacks<BLACK_PAWN>();
+    initPieceAttacks<BLACK_KNIGHT>();
+    initPieceAttacks<BLACK_BISHOP>();
+    initPieceAttacks<BLACK_ROOK>();
+    initPieceAttacks<BLACK_QUEEN>();
+    initPieceAttacks<BLACK_KING>();
 
     evaluateMaterial<WHITE>();
     evaluateMaterial<BLACK>();
@@ -696,78 +432,69 @@ int Evaluation::evaluate() {
     evaluatePst<WHITE>();
     evaluatePst<BLACK>();
 
+    evaluatePawnStructure();
+
     evaluatePieces<WHITE>();
     evaluatePieces<BLACK>();
 
-    int whiteScore = ((whiteMidgameScore * (256 - phase)) + (whiteEndgameScore * phase)) / 256;
-    int blackScore = ((blackMidgameScore * (256 - phase)) + (blackEndgameScore * phase)) / 256;
+    if constexpr (Trace::ENABLED) {
+        trace.phase = phase;
+    }
+
+    int whiteScore = ((midgameScore[WHITE] * (256 - phase)) + (endgameScore[WHITE] * phase)) / 256;
+    int blackScore = ((midgameScore[BLACK] * (256 - phase)) + (endgameScore[BLACK] * phase)) / 256;
 
     return (whiteScore - blackScore) * modifier;
 }
 
+template <typename Trace>
 template <PieceColor color>
-void Evaluation::evaluateMaterial() {
-    if (color == WHITE) {
-        whiteMidgameScore +=
-            bitboard.getMaterialCount<WHITE_PAWN>() * getEvalValue(MIDGAME_PAWN_MATERIAL);
-        whiteEndgameScore +=
-            bitboard.getMaterialCount<WHITE_PAWN>() * getEvalValue(ENDGAME_PAWN_MATERIAL);
-
-        whiteMidgameScore +=
-            bitboard.getMaterialCount<WHITE_KNIGHT>() * getEvalValue(MIDGAME_KNIGHT_MATERIAL);
-        whiteEndgameScore +=
-            bitboard.getMaterialCount<WHITE_KNIGHT>() * getEvalValue(ENDGAME_KNIGHT_MATERIAL);
-
-        whiteMidgameScore +=
-            bitboard.getMaterialCount<WHITE_BISHOP>() * getEvalValue(MIDGAME_BISHOP_MATERIAL);
-        whiteEndgameScore +=
-            bitboard.getMaterialCount<WHITE_BISHOP>() * getEvalValue(ENDGAME_BISHOP_MATERIAL);
-
-        whiteMidgameScore +=
-            bitboard.getMaterialCount<WHITE_ROOK>() * getEvalValue(MIDGAME_ROOK_MATERIAL);
-        whiteEndgameScore +=
-            bitboard.getMaterialCount<WHITE_ROOK>() * getEvalValue(ENDGAME_ROOK_MATERIAL);
-
-        whiteMidgameScore +=
-            bitboard.getMaterialCount<WHITE_QUEEN>() * getEvalValue(MIDGAME_QUEEN_MATERIAL);
-        whiteEndgameScore +=
-            bitboard.getMaterialCount<WHITE_QUEEN>() * getEvalValue(ENDGAME_QUEEN_MATERIAL);
-    } else {
-        blackMidgameScore +=
-            bitboard.getMaterialCount<BLACK_PAWN>() * getEvalValue(MIDGAME_PAWN_MATERIAL);
-        blackEndgameScore +=
-            bitboard.getMaterialCount<BLACK_PAWN>() * getEvalValue(ENDGAME_PAWN_MATERIAL);
-
-        blackMidgameScore +=
-            bitboard.getMaterialCount<BLACK_KNIGHT>() * getEvalValue(MIDGAME_KNIGHT_MATERIAL);
-        blackEndgameScore +=
-            bitboard.getMaterialCount<BLACK_KNIGHT>() * getEvalValue(ENDGAME_KNIGHT_MATERIAL);
-
-        blackMidgameScore +=
-            bitboard.getMaterialCount<BLACK_BISHOP>() * getEvalValue(MIDGAME_BISHOP_MATERIAL);
-        blackEndgameScore +=
-            bitboard.getMaterialCount<BLACK_BISHOP>() * getEvalValue(ENDGAME_BISHOP_MATERIAL);
-
-        blackMidgameScore +=
-            bitboard.getMaterialCount<BLACK_ROOK>() * getEvalValue(MIDGAME_ROOK_MATERIAL);
-        blackEndgameScore +=
-            bitboard.getMaterialCount<BLACK_ROOK>() * getEvalValue(ENDGAME_ROOK_MATERIAL);
-
-        blackMidgameScore +=
-            bitboard.getMaterialCount<BLACK_QUEEN>() * getEvalValue(MIDGAME_QUEEN_MATERIAL);
-        blackEndgameScore +=
-            bitboard.getMaterialCount<BLACK_QUEEN>() * getEvalValue(ENDGAME_QUEEN_MATERIAL);
-    }
+void Evaluation<Trace>::evaluateMaterial() {
+    constexpr PieceType pawn = color == WHITE ? WHITE_PAWN : BLACK_PAWN;
+    constexpr PieceType knight = color == WHITE ? WHITE_KNIGHT : BLACK_KNIGHT;
+    constexpr PieceType bishop = color == WHITE ? WHITE_BISHOP : BLACK_BISHOP;
+    constexpr PieceType rook = color == WHITE ? WHITE_ROOK : BLACK_ROOK;
+    constexpr PieceType queen = color == WHITE ? WHITE_QUEEN : BLACK_QUEEN;
+
+    addScore<color>(MIDGAME_PAWN_MATERIAL, ENDGAME_PAWN_MATERIAL,
+                    bitboard.getMaterialCount<pawn>());
+    addScore<color>(MIDGAME_KNIGHT_MATERIAL, ENDGAME_KNIGHT_MATERIAL,
+                    bitboard.getMaterialCount<knight>());
+    addScore<color>(MIDGAME_BISHOP_MATERIAL, ENDGAME_BISHOP_MATERIAL,
+                    bitboard.getMaterialCount<bishop>());
+    addScore<color>(MIDGAME_ROOK_MATERIAL, ENDGAME_ROOK_MATERIAL,
+                    bitboard.getMaterialCount<rook>());
+    addScore<color>(MIDGAME_QUEEN_MATERIAL, ENDGAME_QUEEN_MATERIAL,
+                    bitboard.getMaterialCount<queen>());
 }
 
+template <typename Trace>
 template <PieceColor color>
-void Evaluation::evaluatePst() {
+void Evaluation<Trace>::evaluatePst() {
     if (color == WHITE) {
-        whiteMidgameScore += bitboard.getWhiteMidgamePst();
-        whiteEndgameScore += bitboard.getWhiteEndgamePst();
+        midgameScore[WHITE] += bitboard.getWhiteMidgamePst();
+        endgameScore[WHITE] += bitboard.getWhiteEndgamePst();
     } else {
-        blackMidgameScore += bitboard.getBlackMidgamePst();
-        blackEndgameScore += bitboard.getBlackEndgamePst();
+        midgameScore[BLACK] += bitboard.getBlackMidgamePst();
+        endgameScore[BLACK] += bitboard.getBlackEndgamePst();
+    }
+
+    if constexpr (Trace::ENABLED) {
+        uint64_t pieces = bitboard.getColorBoard<color>();
+
+        while (pieces) {
+            uint8_t square = popLsb(pieces);
+            int pieceIndex = bitboard.getPieceOnSquare(square) / 2;
+            // The tables of the tuner are from black's point of view (see updateEvalValues())
+            int tableSquare = color == WHITE ? square ^ 56 : square;
+            int parameter = EVAL_FEATURE_COUNT + pieceIndex * SQUARES + tableSquare;
+
+            trace.add(color, parameter, 1);
+            trace.add(color, parameter + PST_PARAMETER_COUNT, 1);
+        }
     }
 }
-} // namespace Zagreus
\ No newline at end of file
+
+template class Evaluation<NoTrace>;
+template class Evaluation<EvalTrace>;
+} // namespace Zagreus
@@ -20,53 +20,109 @@
 
 #pragma once
 
-#include <map>
-
 #include "bitboard.h"
 #include "constants.h"
 #include "features.h"
 
 namespace Zagreus {
-enum TraceMetric {
+// Pawn structure terms only depend on the position of the pawns, which rarely changes. They are
+// cached per search thread, keyed by the pawn hash of the board.
+struct PawnEntry {
+    uint64_t pawnHash = 0;
+    int midgameScore[COLORS]{};
+    int endgameScore[COLORS]{};
+    uint64_t passedPawns[COLORS]{};
 };
 
+static constexpr uint64_t PAWN_TABLE_SIZE = 16384;
+
+struct PawnHashTable {
+    PawnEntry entries[PAWN_TABLE_SIZE]{};
+
+    PawnEntry* getEntry(uint64_t pawnHash) { return &entries[pawnHash & (PAWN_TABLE_SIZE - 1)]; }
+};
+
+// The trace is indexed the same way as the tuner parameters: first the eval features, then the
+// midgame piece square tables and then the endgame piece square tables (see getEvalValues()).
+static constexpr int PST_PARAMETER_COUNT = 6 * SQUARES;
+static constexpr int TRACE_SIZE = EVAL_FEATURE_COUNT + 2 * PST_PARAMETER_COUNT;
+
+// Trace policy used by the search. Everything it does is optimized away.
+struct NoTrace {
+    static constexpr bool ENABLED = false;
+
+    void add(PieceColor /*color*/, int /*parameter*/, int /*count*/) {}
+};
+
+// Trace policy used by the tuner. Counts how often every parameter contributed to the score of
+// each side, so the gradient of the evaluation can be calculated without evaluating again.
+struct EvalTrace {
+    static constexpr bool ENABLED = true;
+
+    int phase = 0;
+    int coefficients[COLORS][TRACE_SIZE]{};
+
+    void add(PieceColor color, int parameter, int count) {
+        coefficients[color][parameter] += count;
+    }
+};
+
+template <typename Trace = NoTrace>
 class Evaluation {
 public:
     Evaluation(Bitboard& bitboard)
         : bitboard(bitboard) {
     }
 
+    Evaluation(Bitboard& bitboard, PawnHashTable& pawnTable)
+        : bitboard(bitboard), pawnTable(&pawnTable) {
+    }
+
     int evaluate();
 
+    const Trace& getTrace() const { return trace; }
+
 private:
     Bitboard& bitboard;
-    std::map<EvalFeature, int> traceMetrics{};
+    PawnHashTable* pawnTable = nullptr;
+    [[no_unique_address]] Trace trace{};
 
+    // Only the entries of occupied squares are written and read, so it is not cleared
+    uint64_t attacksFrom[SQUARES];
     uint64_t attacksByPiece[PIECE_TYPES]{};
     uint64_t attacksByColor[COLORS]{};
     uint64_t attackedBy2[COLORS]{};
-    uint64_t attacksFrom[SQUARES]{};
+    uint64_t passedPawns[COLORS]{};
 
-    int whiteMidgameScore = 0;
-    int whiteEndgameScore = 0;
-    int blackMidgameScore = 0;
-    int blackEndgameScore = 0;
+    int midgameScore[COLORS]{};
+    int endgameScore[COLORS]{};
 
     int getPhase();
 
+    template <PieceColor color>
+    void addScore(EvalFeature midgameFeature, EvalFeature endgameFeature, int count = 1);
+
+    template <PieceColor color>
+    void addPawnScore(PawnEntry& entry, EvalFeature midgameFeature, EvalFeature endgameFeature);
+
     template <PieceColor color>
     void evaluateMaterial();
 
     template <PieceColor color>
     void evaluatePst();
 
+    void evaluatePawnStructure();
+
     template <PieceColor color>
-    void evaluatePieces();
+    void evaluatePawns(PawnEntry& entry);
 
-    inline void addMobilityScoreForPiece(PieceType pieceType, int mobility);
+    template <PieceColor color>
+    void evaluatePieces();
 
-    inline void addKingAttackScore(PieceType pieceType, int attackCount);
+    template <PieceType pieceType>
+    uint64_t getPieceAttacks(uint8_t square);
 
-    void initEvalContext(Bitboard& bitboard);
+    template <PieceType pieceType>
+    void initPieceAttacks();
 };
-} // namespace Zagreus
\ No newline at end of file
+} // namespace Zagreus
@@ -25,13 +25,13 @@
 #include "pst.h"
 
 namespace Zagreus {
-int evalValues[72] = {83, 96, 398, 349, 429, 356, 574, 561, 1063, 1054, 8, 2, 5, 1, 2, 4, 4, 5, 24,
+int evalValues[EVAL_FEATURE_COUNT] = {83, 96, 398, 349, 429, 356, 574, 561, 1063, 1054, 8, 2, 5, 1, 2, 4, 4, 5, 24,
                       -5, -6, 0, -19, 26, 4, 4, -15, 6, -24, 6, -15, -6, -8, -15, -16, 41, -3, -6,
                       -15, -4, -15, -7, -5, -11, 7, 2, -8, -1, -3, -29, -23, -27, 15, 8, -4, -5, 44,
                       2, 15, 15, -28, 3, -2, 2, 19, 17, -9, -31, 13, -17, -29, -31,};
 
 
-int baseEvalValues[72] = {
+int baseEvalValues[EVAL_FEATURE_COUNT] = {
     100, // MIDGAME_PAWN_MATERIAL
     100, // ENDGAME_PAWN_MATERIAL
     350, // MIDGAME_KNIGHT_MATERIAL
@@ -167,11 +167,11 @@ void updateEvalValues(std::vector<float>& newValues) {
         for (int8_t j = 0; j < 64; j++) {
             int pieceIndex = i * 2;
 
-            setMidgamePstValue(static_cast<PieceType>(pieceIndex), 63 - j,
+            setMidgamePstValue(static_cast<PieceType>(pieceIndex), j ^ 56,
                                static_cast<int>(newValues[evalFeatureSize + i * 64 + j]));
             setMidgamePstValue(static_cast<PieceType>(pieceIndex + 1), j,
                                static_cast<int>(newValues[evalFeatureSize + i * 64 + j]));
-            setEndgamePstValue(static_cast<PieceType>(pieceIndex), 63 - j,
+            setEndgamePstValue(static_cast<PieceType>(pieceIndex), j ^ 56,
                                static_cast<int>(newValues[evalFeatureSize + pstSize + i * 64 + j]));
             setEndgamePstValue(static_cast<PieceType>(pieceIndex + 1), j,
                                static_cast<int>(newValues[evalFeatureSize + pstSize + i * 64 + j]));
@@ -98,6 +98,8 @@ enum EvalFeature {
     ENDGAME_MINOR_PIECE_ON_WEAK_SQUARE_PENALTY,
 };
 
+static constexpr int EVAL_FEATURE_COUNT = ENDGAME_MINOR_PIECE_ON_WEAK_SQUARE_PENALTY + 1;
+
 static std::vector<const char*> evalFeatureNames = {
     "MIDGAME_PAWN_MATERIAL",
     "ENDGAME_PAWN_MATERIAL",
@@ -19,74 +19,121 @@
  */
 
 #pragma once
-#include <cstdint>
-
-namespace Zagreus {
-constexpr uint64_t generatorSeed = 0x1C6FE234A7121C08ULL;
-
-#define get_bit(bitboard, square) (bitboard & (1ULL << square))
-#define pop_bit(bitboard, square) (get_bit(bitboard, square) ? (bitboard ^= (1ULL << square)) : 0)
-
-static int RBits[64] = {12, 11, 11, 11, 11, 11, 11, 12, 11, 10, 10, 10, 10, 10, 10, 11,
-                        11, 10, 10, 10, 10, 10, 10, 11, 11, 10, 10, 10, 10, 10, 10, 11,
-                        11, 10, 10, 10, 10, 10, 10, 11, 11, 10, 10, 10, 10, 10, 10, 11,
-                        11, 10, 10, 10, 10, 10, 10, 11, 12, 11, 11, 11, 11, 11, 11, 12};
-
-static int BBits[64] = {6, 5, 5, 5, 5, 5, 5, 6, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 7, 7, 7, 7,
-                        5, 5, 5, 5, 7, 9, 9, 7, 5, 5, 5, 5, 7, 9, 9, 7, 5, 5, 5, 5, 7, 7,
-                        7, 7, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 6, 5, 5, 5, 5, 5, 5, 6};
-
-uint64_t getRookMagic(int sq);
-
-uint64_t getBishopMagic(int sq);
-
-uint64_t getRookMask(int sq);
-
-uint64_t getBishopMask(int sq);
-
-uint64_t getRookMagicAttacks(int sq, uint64_t block);
-
-uint64_t getBishopMagicAttacks(int sq, uint64_t block);
-
-uint64_t random_uint64_t_fewbits();
-
-int count_1s(uint64_t b);
-
-int pop_1st_bit(uint64_t* bb);
-
-uint64_t index_to_uint64_t(int index, int bits, uint64_t m);
 
-uint64_t rmask(int sq);
-
-uint64_t bmask(int sq);
-
-uint64_t ratt(int sq, uint64_t block);
-
-uint64_t batt(int sq, uint64_t block);
-
-int transform(uint64_t b, uint64_t magic, int bits);
-
-uint64_t find_magic(int sq, int m, int bishop);
-
-void generateMagics();
-
-void findFastestSeed();
-
-void init_sliders_attacks(int is_bishop);
-
-uint64_t set_occupancy(int index, int bits_in_mask, uint64_t attack_mask);
-
-int get_ls1b_index(uint64_t bitboard);
-
-uint64_t mask_rook_attacks(int8_t square);
-
-uint64_t mask_bishop_attacks(int8_t square);
-
-int count_bits(uint64_t bitboard);
-
-uint64_t rook_attacks_on_the_fly(int8_t square, uint64_t block);
+#include <array>
+#include <cstdint>
 
-uint64_t bishop_attacks_on_the_fly(int8_t square, uint64_t block);
+// With BMI2, the attack tables are indexed with PEXT instead of the magic multiplication. PEXT is
+// very slow on AMD CPUs before Zen 3, so it can be turned off with the ENABLE_PEXT CMake option.
+#if defined(__BMI2__) && !defined(ZAGREUS_NO_PEXT)
+#define ZAGREUS_PEXT
+#include <immintrin.h>
+#endif
 
-void initializeMagicBitboards();
-} // namespace Zagreus
\ No newline at end of file
+namespace Zagreus {
+inline constexpr int RBits[64] = {12, 11, 11, 11, 11, 11, 11, 12, 11, 10, 10, 10, 10, 10, 10, 11,
+                                  11, 10, 10, 10, 10, 10, 10, 11, 11, 10, 10, 10, 10, 10, 10, 11,
+                                  11, 10, 10, 10, 10, 10, 10, 11, 11, 10, 10, 10, 10, 10, 10, 11,
+                                  11, 10, 10, 10, 10, 10, 10, 11, 12, 11, 11, 11, 11, 11, 11, 12};
+
+inline constexpr int BBits[64] = {6, 5, 5, 5, 5, 5, 5, 6, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 7, 7, 7, 7,
+                                  5, 5, 5, 5, 7, 9, 9, 7, 5, 5, 5, 5, 7, 9, 9, 7, 5, 5, 5, 5, 7, 7,
+                                  7, 7, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 6, 5, 5, 5, 5, 5, 5, 6};
+
+// Found once with the random search from https://www.chessprogramming.org/Looking_for_Magics
+// (seed 0x1C6FE234A7121C08), so they no longer have to be searched for at startup.
+inline constexpr uint64_t ROOK_MAGICS[64] = {
+    0x2080001020400084ULL, 0x0A4002C510026000ULL, 0xB080100082200009ULL, 0x0200040A00201041ULL,
+    0x428008000C000280ULL, 0x0500080100020400ULL, 0x0480008002000100ULL, 0xE10000520082A100ULL,
+    0x0020800020400080ULL, 0x8024802004400080ULL, 0x0008808020001000ULL, 0x1208800800801000ULL,
+    0x0402001022000805ULL, 0x0001000400090002ULL, 0x0131004401000200ULL, 0x0040800040800100ULL,
+    0xA120008080004000ULL, 0x0401414000201001ULL, 0x0004110040200104ULL, 0x4021010020100009ULL,
+    0xC001010010040800ULL, 0x002A808004000200ULL, 0x1100040082015028ULL, 0x0404020024188041ULL,
+    0x0000400180008024ULL, 0x0000200140025002ULL, 0x0000200080801000ULL, 0x0403000900201001ULL,
+    0x0610080080800400ULL, 0x0022000200081004ULL, 0x8A00010400123088ULL, 0x282200420000A104ULL,
+    0x6000804008800020ULL, 0x0000200088804000ULL, 0x8020004800401001ULL, 0x1088080080801002ULL,
+    0x0008004004040020ULL, 0x2042000402000810ULL, 0x1090882104001022ULL, 0x0801001041000082ULL,
+    0x0130400080208008ULL, 0x4000402010004000ULL, 0x0800200043030010ULL, 0x20020140A0920008ULL,
+    0x0008000402004040ULL, 0x0000040002008080ULL, 0x8418020110040008ULL, 0x0481A04081120014ULL,
+    0x0100801821004500ULL, 0x040482402A010200ULL, 0x1000802002100480ULL, 0x0010040008004040ULL,
+    0x0818000400420040ULL, 0x0000020080040080ULL, 0x4005001C2A000B00ULL, 0x0125800041002080ULL,
+    0x0180204014800501ULL, 0x8009058040001121ULL, 0x4002C008A1108202ULL, 0x4082004010609826ULL,
+    0x1401000250080005ULL, 0x000E001058412422ULL, 0x3022009008020104ULL, 0x0000002110408402ULL,
+};
+
+inline constexpr uint64_t BISHOP_MAGICS[64] = {
+    0x03101002081A2024ULL, 0x1008120808510100ULL, 0xE2101122082081B0ULL, 0x26180E00C001C812ULL,
+    0x000110401C002C20ULL, 0x8402180404001200ULL, 0x2081010820048001ULL, 0xA400A104500C2000ULL,
+    0x0104082104048E04ULL, 0x02008210040F2040ULL, 0x0012080801042221ULL, 0x9001244102200CC0ULL,
+    0x0000040420002000ULL, 0x0000808220200000ULL, 0x0001D20882094020ULL, 0x0441108400E21004ULL,
+    0x0110038410020824ULL, 0x0060000504142044ULL, 0x2608010400440008ULL, 0x0048900802004200ULL,
+    0x2042908404200004ULL, 0x00C1000A10020101ULL, 0x0012002049109800ULL, 0x1040510200440410ULL,
+    0x0002204310041000ULL, 0x0004102002301100ULL, 0x0044240026081200ULL, 0x0904004010081080ULL,
+    0x0A10040000802100ULL, 0x0120460001008260ULL, 0x4028420008422204ULL, 0x9081060100484408ULL,
+    0x000A082100042100ULL, 0x400908A020080100ULL, 0x0001004100080810ULL, 0x0820400808008200ULL,
+    0x006800240000C100ULL, 0x288E101208010088ULL, 0x0041040528028818ULL, 0x0002004200004206ULL,
+    0x0004100808010402ULL, 0x006208C220000800ULL, 0x0002101088001000ULL, 0x1441006018020102ULL,
+    0x6024020202004412ULL, 0xC001300100400200ULL, 0x6485040884000600ULL, 0x0004080202500220ULL,
+    0x0081080210040000ULL, 0x1080840422020404ULL, 0x200000444C500065ULL, 0x0008000C42088000ULL,
+    0x0401002813040100ULL, 0x8000204210024406ULL, 0x04B2841004820101ULL, 0x300941010202082CULL,
+    0x0001404610012004ULL, 0xE008818048480480ULL, 0x00A0000040445021ULL, 0x0001108111420A00ULL,
+    0x4408040010020209ULL, 0x040108082008A088ULL, 0x0000300489040404ULL, 0x4002220805040081ULL,
+};
+
+// The attacks of all squares of both sliders are packed into one array. Every square only takes the
+// 2^bits entries its index can address, starting at its offset: first the rook squares, then the
+// bishop squares.
+constexpr std::array<int, 64> getAttackTableOffsets(const int (&bits)[64], int start) {
+    std::array<int, 64> offsets{};
+
+    for (int square = 0; square < 64; square++) {
+        offsets[square] = start;
+        start += 1 << bits[square];
+    }
+
+    return offsets;
+}
+
+inline constexpr std::array<int, 64> ROOK_OFFSETS = getAttackTableOffsets(RBits, 0);
+inline constexpr std::array<int, 64> BISHOP_OFFSETS =
+    getAttackTableOffsets(BBits, ROOK_OFFSETS[63] + (1 << RBits[63]));
+inline constexpr int SLIDER_ATTACK_TABLE_SIZE = BISHOP_OFFSETS[63] + (1 << BBits[63]);
+
+// Generated at compile time in magics.cpp, so they are part of the binary and nothing has to be
+// initialized at startup. The order of the entries of a square depends on whether PEXT is used.
+extern const std::array<uint64_t, 64> ROOK_MASKS;
+extern const std::array<uint64_t, 64> BISHOP_MASKS;
+extern const std::array<uint64_t, SLIDER_ATTACK_TABLE_SIZE> SLIDER_ATTACKS;
+
+inline uint64_t getRookMagic(int sq) { return ROOK_MAGICS[sq]; }
+
+inline uint64_t getBishopMagic(int sq) { return BISHOP_MAGICS[sq]; }
+
+inline uint64_t getRookMask(int sq) { return ROOK_MASKS[sq]; }
+
+inline uint64_t getBishopMask(int sq) { return BISHOP_MASKS[sq]; }
+
+inline uint64_t getRookMagicAttacks(int sq, uint64_t index) {
+    return SLIDER_ATTACKS[ROOK_OFFSETS[sq] + index];
+}
+
+inline uint64_t getBishopMagicAttacks(int sq, uint64_t index) {
+    return SLIDER_ATTACKS[BISHOP_OFFSETS[sq] + index];
+}
+
+inline uint64_t getRookAttackIndex(int sq, uint64_t occupancy) {
+#ifdef ZAGREUS_PEXT
+    return _pext_u64(occupancy, ROOK_MASKS[sq]);
+#else
+    return (occupancy & ROOK_MASKS[sq]) * ROOK_MAGICS[sq] >> (64 - RBits[sq]);
+#endif
+}
+
+inline uint64_t getBishopAttackIndex(int sq, uint64_t occupancy) {
+#ifdef ZAGREUS_PEXT
+    return _pext_u64(occupancy, BISHOP_MASKS[sq]);
+#else
+    return (occupancy & BISHOP_MASKS[sq]) * BISHOP_MAGICS[sq] >> (64 - BBits[sq]);
+#endif
+}
+} // namespace Zagreus
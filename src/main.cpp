@@ -29,7 +29,6 @@
 #include "engine.h"
 #include "evaluate.h"
 #include "features.h"
-#include "magics.h"
 #include "pst.h"
 #include "search.h"
 #include "tt.h"
@@ -37,7 +36,7 @@
 
 using namespace Zagreus;
 
-void benchmark(bool fast);
+void benchmark(bool fast, int hashSize, const std::string& evalFile);
 
 // Some of these benchmark positions are taken from Stockfish's benchmark.cpp:
 // https://github.com/official-stockfish/Stockfish/blob/master/src/benchmark.cpp
@@ -111,7 +110,6 @@ const std::vector<std::string> FAST_BENCHMARK_POSITIONS = {
 int main(int argc, char* argv[]) {
     initializeBitboardConstants();
     initializeSearch();
-    initializeMagicBitboards();
     initializePst();
 
     senjo::Output(senjo::Output::NoPrefix) << "Zagreus  Copyright (C) 2023  Danny Jelsma";
@@ -148,15 +146,17 @@ int main(int argc, char* argv[]) {
         << " by Danny Jelsma (https://github.com/Dannyj1/Zagreus)";
 
     if (argc >= 2) {
-        if (strcmp(argv[1], "bench") == 0) {
-            senjo::Output(senjo::Output::NoPrefix) << "Starting benchmark...";
+        if (strcmp(argv[1], "bench") == 0 || strcmp(argv[1], "fastbench") == 0) {
+            bool fast = strcmp(argv[1], "fastbench") == 0;
+            // Optional hash size in MB, to measure the impact of big transposition tables
+            int hashSize = argc >= 3 ? std::stoi(argv[2]) : 512;
+            // Optional NNUE network, the hand-crafted evaluation is used when none is given
+            std::string evalFile = argc >= 4 ? argv[3] : "";
 
-            benchmark(false);
-            return 0;
-        } else if (strcmp(argv[1], "fastbench") == 0) {
-            senjo::Output(senjo::Output::NoPrefix) << "Starting fast benchmark...";
+            senjo::Output(senjo::Output::NoPrefix)
+                << (fast ? "Starting fast benchmark..." : "Starting benchmark...");
 
-            benchmark(true);
+            benchmark(fast, hashSize, evalFile);
             return 0;
         } else if (strcmp(argv[1], "tune") == 0) {
             startTuning(argv[2]);
@@ -195,41 +195,50 @@ int main(int argc, char* argv[]) {
     }
 }
 
-void benchmark(bool fast) {
+void benchmark(bool fast, int hashSize, const std::string& evalFile) {
     ZagreusEngine engine;
     senjo::UCIAdapter adapter(engine);
     uint64_t nodes = 0;
     double totalMs = 0;
-    Bitboard bb{};
+    ThreadData& thread = engine.getMainThread();
 
     engine.initialize();
-    TranspositionTable::getTT()->setTableSize(512);
+
+    if (!evalFile.empty()) {
+        engine.setEngineOption("EvalFile", evalFile);
+        engine.setEngineOption("UseNNUE", "true");
+    }
+
+    int threadCount = engine.getOption("Threads").getIntValue();
+    TranspositionTable::getTT()->setTableSize(hashSize, threadCount);
     std::vector<std::string> positions = fast ? FAST_BENCHMARK_POSITIONS : BENCHMARK_POSITIONS;
 
     for (const std::string& position : positions) {
         for (int i = 0; i < 2; i++) {
-            TranspositionTable::getTT()->reset();
+            TranspositionTable::getTT()->reset(threadCount);
+            thread.reset();
             PieceColor color = i == 0 ? WHITE : BLACK;
 
-            bb.setFromFen(position);
-            bb.setMovingColor(color);
+            thread.board.setFromFen(position);
+            thread.board.setMovingColor(color);
 
             senjo::GoParams params{};
-            senjo::SearchStats searchStats{};
             params.depth = fast ? 5 : 6;
+            // Every search ends by setting the stop flag, which is cleared here like for a go
+            engine.prepareSearch(params);
 
             auto start = std::chrono::steady_clock::now();
 
             if (color == WHITE) {
-                getBestMove<WHITE>(params, engine, bb, searchStats);
+                getBestMove<WHITE>(params, engine, thread);
             } else {
-                getBestMove<BLACK>(params, engine, bb, searchStats);
+                getBestMove<BLACK>(params, engine, thread);
             }
 
             auto end = std::chrono::steady_clock::now();
             std::chrono::duration<double, std::milli> elapsed = end - start;
 
-            nodes += searchStats.nodes + searchStats.qnodes;
+            nodes += thread.searchStats.nodes + thread.searchStats.qnodes;
             totalMs += elapsed.count();
         }
     }
@@ -23,121 +23,139 @@
 #include <x86intrin.h>
 
 #include <cassert>
+#include <cstdlib>
 #include <iostream>
 
 #include "bitboard.h"
-#include "tt.h"
 #include "utils.h"
 
 namespace Zagreus {
-void addMoveToList(MoveList* moveList, int8_t from, int8_t to = 0, PieceType piece = EMPTY,
-                   int captureScore = 0, PieceType promotionPiece = EMPTY, int score = 0) {
-    moveList->moves[moveList->size].from = from;
-    moveList->moves[moveList->size].to = to;
-    moveList->moves[moveList->size].piece = piece;
-    moveList->moves[moveList->size].captureScore = captureScore;
-    moveList->moves[moveList->size].score = score;
-    moveList->moves[moveList->size].promotionPiece = promotionPiece;
+void addMoveToList(MoveList* moveList, int8_t from, int8_t to, PieceType promotionPiece = EMPTY) {
+    moveList->moves[moveList->size] = encodeMove(from, to, promotionPiece);
     moveList->size++;
 }
 
-int scoreMove(int ply, uint32_t pvMoveCode, Move* move,
-              Move& previousMove, uint32_t moveCode, uint32_t bestMoveCode,
-              TranspositionTable* tt) {
-    if (moveCode == pvMoveCode) {
-        return 500000;
-    }
-
-    if (moveCode == bestMoveCode) {
-        return 250000;
-    }
-
-    if (move->captureScore >= 0) {
-        return 100000 + move->captureScore;
-    }
-
-    if (tt->killerMoves[0][ply] == moveCode) {
-        return 50000;
-    }
+// Used to only generate moves that do not leave the own king in check, so no move has to be made to
+// find out whether it is legal.
+struct LegalityMasks {
+    // The squares that capture or block the checking piece, or every square when not in check
+    uint64_t checkMask;
+    uint64_t pinnedBB;
+    // For each pinned piece, the squares between the king and the pinning piece, including the
+    // pinning piece itself. Only set for the squares in pinnedBB.
+    uint64_t pinRays[SQUARES];
+};
+
+// The pieces of the given color that would attack the square if the board had the given occupancy.
+// Pieces that are not part of the occupancy are ignored, so captured pieces can be left out of it.
+template <PieceColor color>
+uint64_t getAttackersWithOccupancy(Bitboard& bitboard, int8_t square, uint64_t occupancy) {
+    constexpr PieceColor OPPOSITE_COLOR = color == WHITE ? BLACK : WHITE;
+    uint64_t queenBB = bitboard.getPieceBoard(color == WHITE ? WHITE_QUEEN : BLACK_QUEEN);
+    uint64_t rookBB = bitboard.getPieceBoard(color == WHITE ? WHITE_ROOK : BLACK_ROOK) | queenBB;
+    uint64_t bishopBB = bitboard.getPieceBoard(color == WHITE ? WHITE_BISHOP : BLACK_BISHOP)
+                        | queenBB;
+    uint64_t attackers =
+        (getPawnAttacks<OPPOSITE_COLOR>(square)
+         & bitboard.getPieceBoard(color == WHITE ? WHITE_PAWN : BLACK_PAWN))
+        | (getKnightAttacks(square)
+           & bitboard.getPieceBoard(color == WHITE ? WHITE_KNIGHT : BLACK_KNIGHT))
+        | (getKingAttacks(square) & bitboard.getPieceBoard(color == WHITE ? WHITE_KING : BLACK_KING))
+        | (Bitboard::getRookAttacks(square, occupancy) & rookBB)
+        | (Bitboard::getBishopAttacks(square, occupancy) & bishopBB);
+
+    return attackers & occupancy;
+}
 
-    if (tt->killerMoves[1][ply] == moveCode) {
-        return 40000;
-    }
+// Whether moving a piece other than the king from one square to another leaves the own king in
+// check. The captured piece is on captureSquare, which only differs from the to square for en
+// passant.
+template <PieceColor color>
+bool leavesKingInCheck(Bitboard& bitboard, int8_t from, int8_t to, int8_t captureSquare) {
+    constexpr PieceColor OPPOSITE_COLOR = color == WHITE ? BLACK : WHITE;
+    int8_t kingSquare = bitscanForward(bitboard.getPieceBoard(color == WHITE
+        ? WHITE_KING
+        : BLACK_KING));
+    uint64_t occupancy = (bitboard.getOccupiedBoard() & ~(1ULL << from) & ~(1ULL << captureSquare))
+                         | (1ULL << to);
+
+    return getAttackersWithOccupancy<OPPOSITE_COLOR>(bitboard, kingSquare, occupancy)
+           & ~(1ULL << captureSquare);
+}
 
-    if (tt->killerMoves[2][ply] == moveCode) {
-        return 30000;
+template <PieceColor color>
+void computeLegalityMasks(Bitboard& bitboard, LegalityMasks& masks) {
+    constexpr PieceColor OPPOSITE_COLOR = color == WHITE ? BLACK : WHITE;
+    int8_t kingSquare = bitscanForward(bitboard.getPieceBoard(color == WHITE
+        ? WHITE_KING
+        : BLACK_KING));
+    uint64_t checkers = bitboard.getSquareAttackersByColor<OPPOSITE_COLOR>(kingSquare);
+
+    if (!checkers) {
+        masks.checkMask = ~0ULL;
+    } else if (popcnt(checkers) == 1) {
+        int8_t checkerSquare = bitscanForward(checkers);
+        masks.checkMask = checkers;
+
+        if (isSlidingPiece(bitboard.getPieceOnSquare(checkerSquare))) {
+            masks.checkMask |= getBetweenSquares(checkerSquare, kingSquare);
+        }
+    } else {
+        // Double check, only the king can move
+        masks.checkMask = 0;
     }
 
-    if (previousMove.piece != EMPTY && previousMove.to != NO_SQUARE
-        && tt->counterMoves[previousMove.piece][previousMove.to] == moveCode) {
-        return 20000;
+    // Sliders that would attack the king if none of our own pieces were on the board. If exactly one
+    // of our pieces is between them and the king, that piece is pinned.
+    uint64_t opponentBB = bitboard.getColorBoard<OPPOSITE_COLOR>();
+    uint64_t queenBB = bitboard.getPieceBoard(color == WHITE ? BLACK_QUEEN : WHITE_QUEEN);
+    uint64_t rookBB = bitboard.getPieceBoard(color == WHITE ? BLACK_ROOK : WHITE_ROOK) | queenBB;
+    uint64_t bishopBB = bitboard.getPieceBoard(color == WHITE ? BLACK_BISHOP : WHITE_BISHOP)
+                        | queenBB;
+    uint64_t snipers = (Bitboard::getRookAttacks(kingSquare, opponentBB) & rookBB)
+                       | (Bitboard::getBishopAttacks(kingSquare, opponentBB) & bishopBB);
+
+    masks.pinnedBB = 0;
+
+    while (snipers) {
+        int8_t sniperSquare = popLsb(snipers);
+        uint64_t ray = getBetweenSquares(sniperSquare, kingSquare);
+        uint64_t blockers = ray & bitboard.getOccupiedBoard();
+
+        if (popcnt(blockers) == 1 && (blockers & bitboard.getColorBoard<color>())) {
+            masks.pinnedBB |= blockers;
+            masks.pinRays[bitscanForward(blockers)] = ray | (1ULL << sniperSquare);
+        }
     }
+}
 
-    // No capture score is -1, so we need to use < -1
-    if (move->captureScore < -1) {
-        return move->captureScore - 5000;
+// The squares the piece on the given square can move to without leaving the own king in check
+inline uint64_t getLegalSquares(const LegalityMasks& masks, int8_t from) {
+    if (masks.pinnedBB & (1ULL << from)) {
+        return masks.checkMask & masks.pinRays[from];
     }
 
-    return tt->historyMoves[move->piece][move->to];
+    return masks.checkMask;
 }
 
 template <PieceColor color, GenerationType type>
 void generateMoves(Bitboard& bitboard, MoveList* moveList) {
-    constexpr PieceColor OPPOSITE_COLOR = color == WHITE ? BLACK : WHITE;
-    uint64_t evasionSquaresBB = 0;
-
-    if (type == EVASIONS) {
-        int8_t kingSquare = bitscanForward(bitboard.getPieceBoard(color == WHITE
-                ? WHITE_KING
-                : BLACK_KING));
-        uint64_t kingAttackers = bitboard.getSquareAttackersByColor<OPPOSITE_COLOR>(kingSquare);
-
-        // Only generate king moves if there is more than one attacker
-        if (popcnt(kingAttackers) == 1) {
-            int8_t attackerSquare = popLsb(kingAttackers);
-            PieceType attackerPiece = bitboard.getPieceOnSquare(attackerSquare);
-
-            if (isSlidingPiece(attackerPiece)) {
-                evasionSquaresBB |= getBetweenSquares(attackerSquare, kingSquare);
-            }
-
-            evasionSquaresBB |= 1ULL << attackerSquare;
-        }
+    LegalityMasks masks;
+    computeLegalityMasks<color>(bitboard, masks);
+
+    if (masks.checkMask) {
+        generatePawnMoves<color, type>(bitboard, moveList, masks);
+        generateKnightMoves<color, type>(bitboard, moveList, masks);
+        generateBishopMoves<color, type>(bitboard, moveList, masks);
+        generateRookMoves<color, type>(bitboard, moveList, masks);
+        generateQueenMoves<color, type>(bitboard, moveList, masks);
     }
 
-    generatePawnMoves<color, type>(bitboard, moveList, evasionSquaresBB);
-    generateKnightMoves<color, type>(bitboard, moveList, evasionSquaresBB);
-    generateBishopMoves<color, type>(bitboard, moveList, evasionSquaresBB);
-    generateRookMoves<color, type>(bitboard, moveList, evasionSquaresBB);
-    generateQueenMoves<color, type>(bitboard, moveList, evasionSquaresBB);
     generateKingMoves<color, type>(bitboard, moveList);
-
-    TranspositionTable* tt = TranspositionTable::getTT();
-    Line previousPv = bitboard.getPvLine();
-    uint32_t bestMoveCode = 0;
-    uint64_t zobristHash = bitboard.getZobristHash();
-    uint32_t validationHash = bitboard.getZobristHash() >> 32;
-    TTEntry* ttEntry = tt->getEntry(bitboard.getZobristHash());
-
-    if (ttEntry->validationHash == validationHash) {
-        bestMoveCode = ttEntry->bestMoveCode;
-    }
-
-    int ply = bitboard.getPly();
-    int pvFrom = ply - previousPv.startPly;
-    Move pvMove = previousPv.moves[pvFrom];
-    uint32_t pvMoveCode = encodeMove(&pvMove);
-    Move previousMove = bitboard.getPreviousMove();
-
-    for (int i = 0; i < moveList->size; i++) {
-        Move* move = &moveList->moves[i];
-        move->score = scoreMove(ply, pvMoveCode, move, previousMove, encodeMove(move),
-                                bestMoveCode, tt);
-    }
 }
 
 template <PieceColor color, GenerationType type>
-void generatePawnMoves(Bitboard& bitboard, MoveList* moveList, uint64_t evasionSquaresBB) {
+void generatePawnMoves(Bitboard& bitboard, MoveList* moveList, const LegalityMasks& masks) {
     constexpr PieceColor OPPOSITE_COLOR = color == WHITE ? BLACK : WHITE;
     uint64_t pawnBB;
 
@@ -147,16 +165,21 @@ void generatePawnMoves(Bitboard& bitboard, MoveList* moveList, uint64_t evasionS
         pawnBB = bitboard.getPieceBoard(BLACK_PAWN);
     }
 
+    int8_t enPassantSquare = bitboard.getEnPassantSquare();
+    uint64_t enPassantBB = 0;
+
+    if (enPassantSquare != NO_SQUARE) {
+        enPassantBB = 1ULL << enPassantSquare;
+    }
+
     while (pawnBB) {
         int8_t from = popLsb(pawnBB);
         uint64_t genBB = bitboard.getPawnDoublePush<color>(1ULL << from);
-        uint64_t attackableSquares = bitboard.getColorBoard<OPPOSITE_COLOR>();
 
-        if (bitboard.getEnPassantSquare() != NO_SQUARE) {
-            attackableSquares |= 1ULL << bitboard.getEnPassantSquare();
+        if (type != QUIETS) {
+            genBB |= getPawnAttacks<color>(from) & bitboard.getColorBoard<OPPOSITE_COLOR>();
         }
 
-        genBB |= getPawnAttacks<color>(from) & attackableSquares;
         genBB &= ~(bitboard.getColorBoard<color>() | bitboard.getPieceBoard(WHITE_KING) |
                    bitboard.getPieceBoard(BLACK_KING));
 
@@ -164,62 +187,48 @@ void generatePawnMoves(Bitboard& bitboard, MoveList* moveList, uint64_t evasionS
             genBB &= (bitboard.getColorBoard<OPPOSITE_COLOR>() | PROMOTION_SQUARES);
         }
 
-        if (type == EVASIONS) {
-            genBB &= evasionSquaresBB;
+        if (type == CAPTURES) {
+            genBB &= (bitboard.getColorBoard<OPPOSITE_COLOR>() | PROMOTION_SQUARES);
         }
 
+        if (type == QUIETS) {
+            genBB &= ~PROMOTION_SQUARES;
+        }
+
+        genBB &= getLegalSquares(masks, from);
+
         while (genBB) {
             int8_t to = popLsb(genBB);
-            PieceType capturedPiece = bitboard.getPieceOnSquare(to);
-            int captureScore = NO_CAPTURE_SCORE;
-
-            if (color == WHITE) {
-                if (capturedPiece != EMPTY) {
-                    captureScore = type == QSEARCH
-                                       ? bitboard.seeCapture<color>(from, to)
-                                       : mvvlva(WHITE_PAWN, capturedPiece);
-                }
 
-                if (to >= A8) {
-                    addMoveToList(moveList, from, to, WHITE_PAWN, captureScore, WHITE_QUEEN);
+            if ((1ULL << to) & PROMOTION_SQUARES) {
+                addMoveToList(moveList, from, to, color == WHITE ? WHITE_QUEEN : BLACK_QUEEN);
 
-                    if (type == NORMAL) {
-                        addMoveToList(moveList, from, to, WHITE_PAWN, captureScore, WHITE_ROOK);
-                        addMoveToList(moveList, from, to, WHITE_PAWN, captureScore,
-                                      WHITE_BISHOP);
-                        addMoveToList(moveList, from, to, WHITE_PAWN, captureScore,
-                                      WHITE_KNIGHT);
-                    }
-                } else {
-                    addMoveToList(moveList, from, to, WHITE_PAWN, captureScore);
+                if (type == NORMAL || type == CAPTURES) {
+                    addMoveToList(moveList, from, to, color == WHITE ? WHITE_ROOK : BLACK_ROOK);
+                    addMoveToList(moveList, from, to,
+                                  color == WHITE ? WHITE_BISHOP : BLACK_BISHOP);
+                    addMoveToList(moveList, from, to,
+                                  color == WHITE ? WHITE_KNIGHT : BLACK_KNIGHT);
                 }
             } else {
-                if (capturedPiece != EMPTY) {
-                    captureScore = type == QSEARCH
-                                       ? bitboard.seeCapture<color>(from, to)
-                                       : mvvlva(BLACK_PAWN, capturedPiece);
-                }
+                addMoveToList(moveList, from, to);
+            }
+        }
 
-                if (to <= H1) {
-                    addMoveToList(moveList, from, to, BLACK_PAWN, captureScore, BLACK_QUEEN);
+        // En passant can expose the king along the rank of both pawns, which the pin masks do not
+        // see, so it is checked separately
+        if (type != QUIETS && type != QSEARCH && (getPawnAttacks<color>(from) & enPassantBB)) {
+            int8_t captureSquare = color == WHITE ? enPassantSquare - 8 : enPassantSquare + 8;
 
-                    if (type == NORMAL) {
-                        addMoveToList(moveList, from, to, BLACK_PAWN, captureScore, BLACK_ROOK);
-                        addMoveToList(moveList, from, to, BLACK_PAWN, captureScore,
-                                      BLACK_BISHOP);
-                        addMoveToList(moveList, from, to, BLACK_PAWN, captureScore,
-                                      BLACK_KNIGHT);
-                    }
-                } else {
-                    addMoveToList(moveList, from, to, BLACK_PAWN, captureScore);
-                }
+            if (!leavesKingInCheck<color>(bitboard, from, enPassantSquare, captureSquare)) {
+                addMoveToList(moveList, from, enPassantSquare);
             }
         }
     }
 }
 
 template <PieceColor color, GenerationType type>
-void generateKnightMoves(Bitboard& bitboard, MoveList* moveList, uint64_t evasionSquaresBB) {
+void generateKnightMoves(Bitboard& bitboard, MoveList* moveList, const LegalityMasks& masks) {
     constexpr PieceColor OPPOSITE_COLOR = color == WHITE ? BLACK : WHITE;
     uint64_t knightBB;
 
@@ -236,42 +245,25 @@ void generateKnightMoves(Bitboard& bitboard, MoveList* moveList, uint64_t evasio
         genBB &= ~(bitboard.getColorBoard<color>() | bitboard.getPieceBoard(WHITE_KING) |
                    bitboard.getPieceBoard(BLACK_KING));
 
-        if (type == QSEARCH) {
-            genBB &= (bitboard.getColorBoard<OPPOSITE_COLOR>());
+        if (type == QSEARCH || type == CAPTURES) {
+            genBB &= bitboard.getColorBoard<OPPOSITE_COLOR>();
         }
 
-        if (type == EVASIONS) {
-            genBB &= evasionSquaresBB;
+        if (type == QUIETS) {
+            genBB &= ~bitboard.getColorBoard<OPPOSITE_COLOR>();
         }
 
+        genBB &= getLegalSquares(masks, from);
+
         while (genBB) {
             int8_t to = popLsb(genBB);
-            PieceType capturedPiece = bitboard.getPieceOnSquare(to);
-            int captureScore = NO_CAPTURE_SCORE;
-
-            if (color == WHITE) {
-                if (capturedPiece != EMPTY) {
-                    captureScore = type == QSEARCH
-                                       ? bitboard.seeCapture<color>(from, to)
-                                       : mvvlva(WHITE_KNIGHT, capturedPiece);
-                }
-
-                addMoveToList(moveList, from, to, WHITE_KNIGHT, captureScore);
-            } else {
-                if (capturedPiece != EMPTY) {
-                    captureScore = type == QSEARCH
-                                       ? bitboard.seeCapture<color>(from, to)
-                                       : mvvlva(BLACK_KNIGHT, capturedPiece);
-                }
-
-                addMoveToList(moveList, from, to, BLACK_KNIGHT, captureScore);
-            }
+            addMoveToList(moveList, from, to);
         }
     }
 }
 
 template <PieceColor color, GenerationType type>
-void generateBishopMoves(Bitboard& bitboard, MoveList* moveList, uint64_t evasionSquaresBB) {
+void generateBishopMoves(Bitboard& bitboard, MoveList* moveList, const LegalityMasks& masks) {
     constexpr PieceColor OPPOSITE_COLOR = color == WHITE ? BLACK : WHITE;
     uint64_t bishopBB;
 
@@ -288,42 +280,25 @@ void generateBishopMoves(Bitboard& bitboard, MoveList* moveList, uint64_t evasio
         genBB &= ~(bitboard.getColorBoard<color>() | bitboard.getPieceBoard(WHITE_KING) |
                    bitboard.getPieceBoard(BLACK_KING));
 
-        if (type == QSEARCH) {
-            genBB &= (bitboard.getColorBoard<OPPOSITE_COLOR>());
+        if (type == QSEARCH || type == CAPTURES) {
+            genBB &= bitboard.getColorBoard<OPPOSITE_COLOR>();
         }
 
-        if (type == EVASIONS) {
-            genBB &= evasionSquaresBB;
+        if (type == QUIETS) {
+            genBB &= ~bitboard.getColorBoard<OPPOSITE_COLOR>();
         }
 
+        genBB &= getLegalSquares(masks, from);
+
         while (genBB) {
             int8_t to = popLsb(genBB);
-            PieceType capturedPiece = bitboard.getPieceOnSquare(to);
-            int captureScore = NO_CAPTURE_SCORE;
-
-            if (color == WHITE) {
-                if (capturedPiece != EMPTY) {
-                    captureScore = type == QSEARCH
-                                       ? bitboard.seeCapture<color>(from, to)
-                                       : mvvlva(WHITE_BISHOP, capturedPiece);
-                }
-
-                addMoveToList(moveList, from, to, WHITE_BISHOP, captureScore);
-            } else {
-                if (capturedPiece != EMPTY) {
-                    captureScore = type == QSEARCH
-                                       ? bitboard.seeCapture<color>(from, to)
-                                       : mvvlva(BLACK_BISHOP, capturedPiece);
-                }
-
-                addMoveToList(moveList, from, to, BLACK_BISHOP, captureScore);
-            }
+            addMoveToList(moveList, from, to);
         }
     }
 }
 
 template <PieceColor color, GenerationType type>
-void generateRookMoves(Bitboard& bitboard, MoveList* moveList, uint64_t evasionSquaresBB) {
+void generateRookMoves(Bitboard& bitboard, MoveList* moveList, const LegalityMasks& masks) {
     constexpr PieceColor OPPOSITE_COLOR = color == WHITE ? BLACK : WHITE;
     uint64_t rookBB;
 
@@ -340,42 +315,25 @@ void generateRookMoves(Bitboard& bitboard, MoveList* moveList, uint64_t evasionS
         genBB &= ~(bitboard.getColorBoard<color>() | bitboard.getPieceBoard(WHITE_KING) |
                    bitboard.getPieceBoard(BLACK_KING));
 
-        if (type == QSEARCH) {
-            genBB &= (bitboard.getColorBoard<OPPOSITE_COLOR>());
+        if (type == QSEARCH || type == CAPTURES) {
+            genBB &= bitboard.getColorBoard<OPPOSITE_COLOR>();
         }
 
-        if (type == EVASIONS) {
-            genBB &= evasionSquaresBB;
+        if (type == QUIETS) {
+            genBB &= ~bitboard.getColorBoard<OPPOSITE_COLOR>();
         }
 
+        genBB &= getLegalSquares(masks, from);
+
         while (genBB) {
             int8_t to = popLsb(genBB);
-            PieceType capturedPiece = bitboard.getPieceOnSquare(to);
-            int captureScore = NO_CAPTURE_SCORE;
-
-            if (color == WHITE) {
-                if (capturedPiece != EMPTY) {
-                    captureScore = type == QSEARCH
-                                       ? bitboard.seeCapture<color>(from, to)
-                                       : mvvlva(WHITE_ROOK, capturedPiece);
-                }
-
-                addMoveToList(moveList, from, to, WHITE_ROOK, captureScore);
-            } else {
-                if (capturedPiece != EMPTY) {
-                    captureScore = type == QSEARCH
-                                       ? bitboard.seeCapture<color>(from, to)
-                                       : mvvlva(BLACK_ROOK, capturedPiece);
-                }
-
-                addMoveToList(moveList, from, to, BLACK_ROOK, captureScore);
-            }
+            addMoveToList(moveList, from, to);
         }
     }
 }
 
 template <PieceColor color, GenerationType type>
-void generateQueenMoves(Bitboard& bitboard, MoveList* moveList, uint64_t evasionSquaresBB) {
+void generateQueenMoves(Bitboard& bitboard, MoveList* moveList, const LegalityMasks& masks) {
     constexpr PieceColor OPPOSITE_COLOR = color == WHITE ? BLACK : WHITE;
     uint64_t queenBB;
 
@@ -392,38 +350,62 @@ void generateQueenMoves(Bitboard& bitboard, MoveList* moveList, uint64_t evasion
         genBB &= ~(bitboard.getColorBoard<color>() | bitboard.getPieceBoard(WHITE_KING) |
                    bitboard.getPieceBoard(BLACK_KING));
 
-        if (type == QSEARCH) {
-            genBB &= (bitboard.getColorBoard<OPPOSITE_COLOR>());
+        if (type == QSEARCH || type == CAPTURES) {
+            genBB &= bitboard.getColorBoard<OPPOSITE_COLOR>();
         }
 
-        if (type == EVASIONS) {
-            genBB &= evasionSquaresBB;
+        if (type == QUIETS) {
+            genBB &= ~bitboard.getColorBoard<OPPOSITE_COLOR>();
         }
 
+        genBB &= getLegalSquares(masks, from);
+
         while (genBB) {
             int8_t to = popLsb(genBB);
-            PieceType capturedPiece = bitboard.getPieceOnSquare(to);
-            int captureScore = NO_CAPTURE_SCORE;
-
-            if (color == WHITE) {
-                if (capturedPiece != EMPTY) {
-                    captureScore = type == QSEARCH
-                                       ? bitboard.seeCapture<color>(from, to)
-                                       : mvvlva(WHITE_QUEEN, capturedPiece);
-                }
+            addMoveToList(moveList, from, to);
+        }
+    }
+}
 
-                addMoveToList(moveList, from, to, WHITE_QUEEN, captureScore);
-            } else {
-                if (capturedPiece != EMPTY) {
-                    captureScore = type == QSEARCH
-                                       ? bitboard.seeCapture<color>(from, to)
-                                       : mvvlva(BLACK_QUEEN, capturedPiece);
-                }
+// Whether the king can castle to the given side. The king may not be in check, and may not pass
+// through or land on an attacked square.
+template <PieceColor color>
+bool canCastle(Bitboard& bitboard, CastlingRights side) {
+    constexpr PieceColor OPPOSITE_COLOR = color == WHITE ? BLACK : WHITE;
+    constexpr PieceType ROOK = color == WHITE ? WHITE_ROOK : BLACK_ROOK;
+    bool kingSide = side == WHITE_KINGSIDE || side == BLACK_KINGSIDE;
+    uint64_t betweenSquares;
+    int8_t rookSquare;
 
-                addMoveToList(moveList, from, to, BLACK_QUEEN, captureScore);
-            }
+    if (color == WHITE) {
+        betweenSquares = kingSide ? WHITE_KING_SIDE_BETWEEN : WHITE_QUEEN_SIDE_BETWEEN;
+        rookSquare = kingSide ? H1 : A1;
+    } else {
+        betweenSquares = kingSide ? BLACK_KING_SIDE_BETWEEN : BLACK_QUEEN_SIDE_BETWEEN;
+        rookSquare = kingSide ? H8 : A8;
+    }
+
+    if (!(bitboard.getCastlingRights() & side) || (bitboard.getOccupiedBoard() & betweenSquares)
+        || bitboard.getPieceOnSquare(rookSquare) != ROOK || bitboard.isKingInCheck<color>()) {
+        return false;
+    }
+
+    // The square next to the rook on the queen side only has to be empty
+    uint64_t tilesToCheck = betweenSquares;
+
+    if (!kingSide) {
+        tilesToCheck &= ~(1ULL << (color == WHITE ? B1 : B8));
+    }
+
+    while (tilesToCheck) {
+        int8_t square = popLsb(tilesToCheck);
+
+        if (bitboard.isSquareAttackedByColor<OPPOSITE_COLOR>(square)) {
+            return false;
         }
     }
+
+    return true;
 }
 
 template <PieceColor color, GenerationType type>
@@ -446,121 +428,139 @@ void generateKingMoves(Bitboard& bitboard, MoveList* moveList) {
 
     genBB &= ~(bitboard.getColorBoard<color>() | getKingAttacks(opponentKingSquare));
 
-    if (type == QSEARCH) {
+    if (type == QSEARCH || type == CAPTURES) {
         genBB &= bitboard.getColorBoard<OPPOSITE_COLOR>();
     }
 
+    if (type == QUIETS) {
+        genBB &= ~bitboard.getColorBoard<OPPOSITE_COLOR>();
+    }
+
+    // The king can't block an attack on the square it moves to, so look through it
+    uint64_t occupancy = bitboard.getOccupiedBoard() & ~kingBB;
+
     while (genBB) {
         int8_t to = popLsb(genBB);
-        PieceType capturedPiece = bitboard.getPieceOnSquare(to);
-        int captureScore = NO_CAPTURE_SCORE;
-
-        if (color == WHITE) {
-            if (capturedPiece != EMPTY) {
-                captureScore = type == QSEARCH
-                                   ? bitboard.seeCapture<color>(from, to)
-                                   : mvvlva(WHITE_KING, capturedPiece);
-            }
-
-            addMoveToList(moveList, from, to, WHITE_KING, captureScore);
-        } else {
-            if (capturedPiece != EMPTY) {
-                captureScore = type == QSEARCH
-                                   ? bitboard.seeCapture<color>(from, to)
-                                   : mvvlva(BLACK_KING, capturedPiece);
-            }
 
-            addMoveToList(moveList, from, to, BLACK_KING, captureScore);
+        if (!getAttackersWithOccupancy<OPPOSITE_COLOR>(bitboard, to, occupancy)) {
+            addMoveToList(moveList, from, to);
         }
     }
 
-    if (type == QSEARCH || type == EVASIONS) {
+    if (type == QSEARCH || type == EVASIONS || type == CAPTURES) {
         return;
     }
 
-    uint64_t occupiedBB = bitboard.getOccupiedBoard();
-
     if (color == WHITE) {
-        if (bitboard.getCastlingRights() & WHITE_KINGSIDE &&
-            (occupiedBB & WHITE_KING_SIDE_BETWEEN) == 0 &&
-            bitboard.getPieceOnSquare(H1) == WHITE_ROOK && !bitboard.isKingInCheck<WHITE>()) {
-            uint64_t tilesToCheck = WHITE_KING_SIDE_BETWEEN;
-            bool canCastle = true;
-
-            while (tilesToCheck) {
-                int8_t tilefrom = popLsb(tilesToCheck);
-
-                if (bitboard.isSquareAttackedByColor<BLACK>(tilefrom)) {
-                    canCastle = false;
-                    break;
-                }
-            }
+        if (canCastle<WHITE>(bitboard, WHITE_KINGSIDE)) {
+            addMoveToList(moveList, from, G1);
+        }
 
-            if (canCastle) {
-                addMoveToList(moveList, from, G1, WHITE_KING, -1);
-            }
+        if (canCastle<WHITE>(bitboard, WHITE_QUEENSIDE)) {
+            addMoveToList(moveList, from, C1);
+        }
+    } else {
+        if (canCastle<BLACK>(bitboard, BLACK_KINGSIDE)) {
+            addMoveToList(moveList, from, G8);
+        }
+
+        if (canCastle<BLACK>(bitboard, BLACK_QUEENSIDE)) {
+            addMoveToList(moveList, from, C8);
         }
+    }
+}
 
-        if (bitboard.getCastlingRights() & WHITE_QUEENSIDE &&
-            (occupiedBB & WHITE_QUEEN_SIDE_BETWEEN) == 0 &&
-            bitboard.getPieceOnSquare(A1) == WHITE_ROOK && !bitboard.isKingInCheck<WHITE>()) {
-            uint64_t tilesToCheck = WHITE_QUEEN_SIDE_BETWEEN & ~(1ULL << B1);
-            bool canCastle = true;
+// Checks whether the given move (from the TT or the killer/counter move tables) is a move that
+// generateMoves could have generated in the current position. Used to try those moves before any
+// moves are generated.
+template <PieceColor color>
+bool isLegalMove(Bitboard& bitboard, Move move) {
+    constexpr PieceColor OPPOSITE_COLOR = color == WHITE ? BLACK : WHITE;
+    int8_t from = getFromSquare(move);
+    int8_t to = getToSquare(move);
+    PieceType piece = bitboard.getPieceOnSquare(from);
 
-            while (tilesToCheck) {
-                int8_t tilefrom = popLsb(tilesToCheck);
+    // The promotion types above queen can't be produced by encodeMove
+    if (from == to || piece == EMPTY || piece % 2 != color || (move >> 12) > 4) {
+        return false;
+    }
 
-                if (bitboard.isSquareAttackedByColor<BLACK>(tilefrom)) {
-                    canCastle = false;
-                    break;
-                }
-            }
+    uint64_t toBB = 1ULL << to;
 
-            if (canCastle) {
-                addMoveToList(moveList, from, C1, WHITE_KING, -1);
-            }
+    if (toBB & (bitboard.getColorBoard<color>() | bitboard.getPieceBoard(WHITE_KING) |
+                bitboard.getPieceBoard(BLACK_KING))) {
+        return false;
+    }
+
+    uint64_t genBB;
+
+    if (isPawn(piece)) {
+        uint64_t attackableSquares = bitboard.getColorBoard<OPPOSITE_COLOR>();
+
+        if (bitboard.getEnPassantSquare() != NO_SQUARE) {
+            attackableSquares |= 1ULL << bitboard.getEnPassantSquare();
         }
-    } else {
-        if (bitboard.getCastlingRights() & BLACK_KINGSIDE &&
-            (occupiedBB & BLACK_KING_SIDE_BETWEEN) == 0 &&
-            bitboard.getPieceOnSquare(H8) == BLACK_ROOK && !bitboard.isKingInCheck<BLACK>()) {
-            uint64_t tilesToCheck = BLACK_KING_SIDE_BETWEEN;
-            bool canCastle = true;
-
-            while (tilesToCheck) {
-                int8_t tilefrom = popLsb(tilesToCheck);
-
-                if (bitboard.isSquareAttackedByColor<WHITE>(tilefrom)) {
-                    canCastle = false;
-                    break;
-                }
-            }
 
-            if (canCastle) {
-                addMoveToList(moveList, from, G8, BLACK_KING, -1);
-            }
+        genBB = bitboard.getPawnDoublePush<color>(1ULL << from);
+        genBB |= getPawnAttacks<color>(from) & attackableSquares;
+
+        if (static_cast<bool>(toBB & PROMOTION_SQUARES) != isPromotion(move)) {
+            return false;
+        }
+    } else {
+        if (isPromotion(move)) {
+            return false;
         }
 
-        if (bitboard.getCastlingRights() & BLACK_QUEENSIDE &&
-            (occupiedBB & BLACK_QUEEN_SIDE_BETWEEN) == 0 &&
-            bitboard.getPieceOnSquare(A8) == BLACK_ROOK && !bitboard.isKingInCheck<BLACK>()) {
-            uint64_t tilesToCheck = BLACK_QUEEN_SIDE_BETWEEN & ~(1ULL << B8);
-            bool canCastle = true;
+        if (isKnight(piece)) {
+            genBB = getKnightAttacks(from);
+        } else if (isBishop(piece)) {
+            genBB = bitboard.getBishopAttacks(from);
+        } else if (isRook(piece)) {
+            genBB = bitboard.getRookAttacks(from);
+        } else if (isQueen(piece)) {
+            genBB = bitboard.getQueenAttacks(from);
+        } else {
+            int8_t opponentKingSquare = bitscanForward(
+                bitboard.getPieceBoard(color == WHITE ? BLACK_KING : WHITE_KING));
+            genBB = getKingAttacks(from) & ~getKingAttacks(opponentKingSquare);
 
-            while (tilesToCheck) {
-                int8_t tilefrom = popLsb(tilesToCheck);
+            if (from == (color == WHITE ? E1 : E8) && (to == from + 2 || to == from - 2)) {
+                CastlingRights side;
 
-                if (bitboard.isSquareAttackedByColor<WHITE>(tilefrom)) {
-                    canCastle = false;
-                    break;
+                if (color == WHITE) {
+                    side = to == G1 ? WHITE_KINGSIDE : WHITE_QUEENSIDE;
+                } else {
+                    side = to == G8 ? BLACK_KINGSIDE : BLACK_QUEENSIDE;
+                }
+
+                if (!canCastle<color>(bitboard, side)) {
+                    return false;
                 }
-            }
 
-            if (canCastle) {
-                addMoveToList(moveList, from, C8, BLACK_KING, -1);
+                genBB |= toBB;
             }
         }
     }
+
+    if (!(genBB & toBB)) {
+        return false;
+    }
+
+    if (isKing(piece)) {
+        // Castling moves were already checked by canCastle
+        return std::abs(to - from) == 2
+               || !getAttackersWithOccupancy<OPPOSITE_COLOR>(
+                   bitboard, to, bitboard.getOccupiedBoard() & ~(1ULL << from));
+    }
+
+    int8_t captureSquare = to;
+
+    if (isPawn(piece) && to == bitboard.getEnPassantSquare()) {
+        captureSquare = color == WHITE ? to - 8 : to + 8;
+    }
+
+    return !leavesKingInCheck<color>(bitboard, from, to, captureSquare);
 }
 
 template void generateMoves<WHITE, NORMAL>(Bitboard& bitboard, MoveList* moveList);
@@ -569,4 +569,10 @@ template void generateMoves<WHITE, EVASIONS>(Bitboard& bitboard, MoveList* moveL
 template void generateMoves<BLACK, NORMAL>(Bitboard& bitboard, MoveList* moveList);
 template void generateMoves<BLACK, QSEARCH>(Bitboard& bitboard, MoveList* moveList);
 template void generateMoves<BLACK, EVASIONS>(Bitboard& bitboard, MoveList* moveList);
+template void generateMoves<WHITE, CAPTURES>(Bitboard& bitboard, MoveList* moveList);
+template void generateMoves<WHITE, QUIETS>(Bitboard& bitboard, MoveList* moveList);
+template void generateMoves<BLACK, CAPTURES>(Bitboard& bitboard, MoveList* moveList);
+template void generateMoves<BLACK, QUIETS>(Bitboard& bitboard, MoveList* moveList);
+template bool isLegalMove<WHITE>(Bitboard& bitboard, Move move);
+template bool isLegalMove<BLACK>(Bitboard& bitboard, Move move);
 } // namespace Zagreus
\ No newline at end of file
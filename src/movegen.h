@@ -21,14 +21,20 @@
 #pragma once
 
 #include "bitboard.h"
+#include "types.h"
 
 namespace Zagreus {
 enum GenerationType {
     NORMAL,
     QSEARCH,
     EVASIONS,
+    CAPTURES, // Captures and promotions
+    QUIETS, // Everything that is not generated by CAPTURES
 };
 
 template <PieceColor color, GenerationType type>
 void generateMoves(Bitboard& bitboard, MoveList* moveList);
+
+template <PieceColor color>
+bool isLegalMove(Bitboard& bitboard, Move move);
 } // namespace Zagreus
\ No newline at end of file
@@ -20,29 +20,327 @@
 
 #include "movepicker.h"
 
+#include "tt.h"
+#include "utils.h"
+
 namespace Zagreus {
-Move MovePicker::getNextMove() {
-    int highestScore = moveList->moves[searchStartIndex].score;
-    int moveIndex = searchStartIndex;
+template <PieceColor color>
+MovePicker<color>::MovePicker(ThreadData& thread, GenerationType type)
+    : thread(thread), type(type) {
+    moveList = thread.getMoveList(thread.board.getPly());
+    stage = type == QSEARCH ? GENERATE_ALL_MOVES : PV_MOVE;
+}
+
+template <PieceColor color>
+bool MovePicker<color>::isPicked(Move move) const {
+    for (int i = 0; i < pickedMoveCount; i++) {
+        if (pickedMoves[i] == move) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+template <PieceColor color>
+bool MovePicker<color>::pickMove(Move move, bool quietOnly) {
+    if (move == NO_MOVE || isPicked(move) || !isLegalMove<color>(thread.board, move)) {
+        return false;
+    }
+
+    if (quietOnly && !thread.board.isQuietMove(move)) {
+        return false;
+    }
+
+    pickedMoves[pickedMoveCount++] = move;
+    return true;
+}
+
+// Swaps the move with the highest score between moveIndex and endIndex to moveIndex
+template <PieceColor color>
+Move MovePicker<color>::selectBestMove(int endIndex) {
+    int bestIndex = moveIndex;
+
+    for (int i = moveIndex + 1; i < endIndex; i++) {
+        if (moveList->scores[i] > moveList->scores[bestIndex]) {
+            bestIndex = i;
+        }
+    }
+
+    std::swap(moveList->moves[moveIndex], moveList->moves[bestIndex]);
+    std::swap(moveList->scores[moveIndex], moveList->scores[bestIndex]);
+    return moveList->moves[moveIndex++];
+}
+
+// Under promotions and captures that lose material according to SEE are searched after the quiet
+// moves
+template <PieceColor color>
+bool MovePicker<color>::isBadCapture(Move move) {
+    if (isPromotion(move)) {
+        return getPromotionPiece(move, color) != (color == WHITE ? WHITE_QUEEN : BLACK_QUEEN);
+    }
 
-    for (int i = searchStartIndex + 1; i < moveList->size; i++) {
-        int currentScore = moveList->moves[i].score;
-        if (currentScore > highestScore) {
-            highestScore = currentScore;
-            moveIndex = i;
+    int8_t from = getFromSquare(move);
+    int8_t to = getToSquare(move);
+    PieceType capturedPiece = thread.board.getPieceOnSquare(to);
+
+    // Captures of a piece that is worth at least as much never lose material (this includes en
+    // passant, where the captured pawn is not on the target square)
+    if (capturedPiece == EMPTY
+        || getPieceWeight(capturedPiece) >= getPieceWeight(thread.board.getPieceOnSquare(from))) {
+        return false;
+    }
+
+    return thread.board.seeCapture<color>(from, to) < 0;
+}
+
+// Scores the moves of the EVASIONS and QSEARCH stages, which are all generated at once. In QSEARCH,
+// captures that lose material are removed from the list.
+template <PieceColor color>
+void MovePicker<color>::scoreAllMoves() {
+    Bitboard& board = thread.board;
+    int ply = board.getPly();
+    Move previousMove = board.getPreviousMove();
+    Move counterMove = NO_MOVE;
+    Move ttMove = NO_MOVE;
+    Move pvMove = NO_MOVE;
+    const Line& previousPv = board.getPvLine();
+    int pvIndex = ply - previousPv.startPly;
+    TTEntry ttEntry{};
+    int size = 0;
+
+    if (previousMove != NO_MOVE) {
+        PieceType previousPiece = board.getPieceOnSquare(getToSquare(previousMove));
+
+        if (previousPiece != EMPTY) {
+            counterMove = thread.counterMoves[previousPiece][getToSquare(previousMove)];
         }
     }
 
-    std::swap(moveList->moves[searchStartIndex], moveList->moves[moveIndex]);
-    searchStartIndex++;
-    return moveList->moves[searchStartIndex - 1];
+    if (type == QSEARCH) {
+        if (TranspositionTable::getTT()->getEntry(board.getZobristHash(), ttEntry)) {
+            ttMove = ttEntry.bestMove;
+        }
+
+        if (pvIndex >= 0 && pvIndex < previousPv.moveCount) {
+            pvMove = previousPv.moves[pvIndex];
+        }
+    }
+
+    for (int i = 0; i < moveList->size; i++) {
+        Move move = moveList->moves[i];
+        int8_t from = getFromSquare(move);
+        int8_t to = getToSquare(move);
+        PieceType piece = board.getPieceOnSquare(from);
+        PieceType capturedPiece = board.getPieceOnSquare(to);
+        int score;
+
+        if (capturedPiece != EMPTY) {
+            if (type == QSEARCH) {
+                int see = board.seeCapture<color>(from, to);
+
+                if (see < 0) {
+                    continue;
+                }
+
+                score = 100000 + see;
+            } else {
+                score = 100000 + mvvlva(piece, capturedPiece);
+            }
+        } else if (thread.killerMoves[0][ply] == move) {
+            score = 50000;
+        } else if (thread.killerMoves[1][ply] == move) {
+            score = 40000;
+        } else if (thread.killerMoves[2][ply] == move) {
+            score = 30000;
+        } else if (counterMove == move) {
+            score = 20000;
+        } else {
+            score = static_cast<int>(thread.historyMoves[piece][to]);
+        }
+
+        // Only set in QSEARCH, in EVASIONS they were already returned before the generation
+        if (move == pvMove) {
+            score = 500000;
+        } else if (move == ttMove) {
+            score = 250000;
+        }
+
+        moveList->moves[size] = move;
+        moveList->scores[size] = score;
+        size++;
+    }
+
+    moveList->size = size;
 }
 
-bool MovePicker::hasNext() { return searchStartIndex < moveList->size; }
+template <PieceColor color>
+bool MovePicker<color>::getNextMove(Move& move) {
+    Bitboard& board = thread.board;
 
-int MovePicker::size() { return moveList->size; }
+    switch (stage) {
+    case PV_MOVE: {
+        stage = TT_MOVE;
+        const Line& previousPv = board.getPvLine();
+        int pvIndex = board.getPly() - previousPv.startPly;
 
-int MovePicker::remaining() { return moveList->size - searchStartIndex; }
+        if (pvIndex >= 0 && pvIndex < previousPv.moveCount
+            && pickMove(previousPv.moves[pvIndex], false)) {
+            move = previousPv.moves[pvIndex];
+            return true;
+        }
+    }
+        [[fallthrough]];
+    case TT_MOVE: {
+        stage = type == EVASIONS ? GENERATE_ALL_MOVES : GENERATE_CAPTURES;
+        TTEntry ttEntry{};
+
+        if (TranspositionTable::getTT()->getEntry(board.getZobristHash(), ttEntry)
+            && pickMove(ttEntry.bestMove, false)) {
+            move = ttEntry.bestMove;
+            return true;
+        }
+
+        if (type == EVASIONS) {
+            return getNextMove(move);
+        }
+    }
+        [[fallthrough]];
+    case GENERATE_CAPTURES:
+        generateMoves<color, CAPTURES>(board, moveList);
+
+        for (int i = 0; i < moveList->size; i++) {
+            Move capture = moveList->moves[i];
+            PieceType capturedPiece = board.getPieceOnSquare(getToSquare(capture));
+            int score = 0;
+
+            if (capturedPiece != EMPTY) {
+                score = mvvlva(board.getPieceOnSquare(getFromSquare(capture)), capturedPiece);
+            }
+
+            if (getPromotionPiece(capture, color) == (color == WHITE ? WHITE_QUEEN : BLACK_QUEEN)) {
+                score += 1000;
+            }
+
+            moveList->scores[i] = score;
+        }
+
+        capturesEnd = moveList->size;
+        stage = GOOD_CAPTURES;
+        [[fallthrough]];
+    case GOOD_CAPTURES:
+        while (moveIndex < capturesEnd) {
+            Move capture = selectBestMove(capturesEnd);
+
+            if (isPicked(capture)) {
+                continue;
+            }
+
+            // Bad captures are moved to the front of the list, where they are picked up again in
+            // the BAD_CAPTURES stage
+            if (isBadCapture(capture)) {
+                moveList->moves[badCapturesEnd++] = capture;
+                continue;
+            }
+
+            move = capture;
+            return true;
+        }
+
+        stage = KILLER_MOVES;
+        [[fallthrough]];
+    case KILLER_MOVES:
+        while (killerIndex < 3) {
+            Move killerMove = thread.killerMoves[killerIndex++][board.getPly()];
+
+            if (pickMove(killerMove, true)) {
+                move = killerMove;
+                return true;
+            }
+        }
+
+        stage = COUNTER_MOVE;
+        [[fallthrough]];
+    case COUNTER_MOVE: {
+        stage = GENERATE_QUIETS;
+        Move previousMove = board.getPreviousMove();
+
+        if (previousMove != NO_MOVE) {
+            int8_t previousTo = getToSquare(previousMove);
+            PieceType previousPiece = board.getPieceOnSquare(previousTo);
+
+            if (previousPiece != EMPTY
+                && pickMove(thread.counterMoves[previousPiece][previousTo], true)) {
+                move = thread.counterMoves[previousPiece][previousTo];
+                return true;
+            }
+        }
+    }
+        [[fallthrough]];
+    case GENERATE_QUIETS:
+        generateMoves<color, QUIETS>(board, moveList);
+
+        for (int i = capturesEnd; i < moveList->size; i++) {
+            Move quiet = moveList->moves[i];
+            PieceType piece = board.getPieceOnSquare(getFromSquare(quiet));
+
+            moveList->scores[i] = static_cast<int>(
+                thread.historyMoves[piece][getToSquare(quiet)]);
+        }
+
+        moveIndex = capturesEnd;
+        stage = QUIET_MOVES;
+        [[fallthrough]];
+    case QUIET_MOVES:
+        while (moveIndex < moveList->size) {
+            Move quiet = selectBestMove(moveList->size);
+
+            if (!isPicked(quiet)) {
+                move = quiet;
+                return true;
+            }
+        }
+
+        moveIndex = 0;
+        stage = BAD_CAPTURES;
+        [[fallthrough]];
+    case BAD_CAPTURES:
+        if (moveIndex < badCapturesEnd) {
+            move = moveList->moves[moveIndex++];
+            return true;
+        }
+
+        stage = DONE;
+        return false;
+    case GENERATE_ALL_MOVES:
+        if (type == EVASIONS) {
+            generateMoves<color, EVASIONS>(board, moveList);
+        } else {
+            generateMoves<color, QSEARCH>(board, moveList);
+        }
+
+        scoreAllMoves();
+        stage = ALL_MOVES;
+        [[fallthrough]];
+    case ALL_MOVES:
+        while (moveIndex < moveList->size) {
+            Move nextMove = selectBestMove(moveList->size);
+
+            if (!isPicked(nextMove)) {
+                move = nextMove;
+                return true;
+            }
+        }
+
+        stage = DONE;
+        return false;
+    case DONE:
+        return false;
+    }
+
+    return false;
+}
 
-int MovePicker::movesSearched() { return searchStartIndex; }
-} // namespace Zagreus
\ No newline at end of file
+template class MovePicker<WHITE>;
+template class MovePicker<BLACK>;
+} // namespace Zagreus
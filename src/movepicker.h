@@ -20,31 +20,64 @@
 
 #pragma once
 
-#include <vector>
-
+#include "movegen.h"
+#include "thread_data.h"
 #include "types.h"
 
 namespace Zagreus {
+enum MovePickerStage {
+    PV_MOVE,
+    TT_MOVE,
+    GENERATE_CAPTURES,
+    GOOD_CAPTURES,
+    KILLER_MOVES,
+    COUNTER_MOVE,
+    GENERATE_QUIETS,
+    QUIET_MOVES,
+    BAD_CAPTURES,
+    GENERATE_ALL_MOVES,
+    ALL_MOVES,
+    DONE,
+};
+
+// Returns the moves of a position in the order they should be searched. With NORMAL, the moves are
+// generated lazily in stages: the PV and TT move, good captures, killer moves, the counter move,
+// quiet moves and finally bad captures. Every stage is only generated once it is reached, so no
+// moves have to be generated at all when the TT move causes a cutoff. With EVASIONS, all evasions
+// are generated at once after the PV and TT move. With QSEARCH all moves are generated at once and
+// captures that lose material according to SEE are left out. Only legal moves are returned.
+template <PieceColor color>
 class MovePicker {
 private:
+    ThreadData& thread;
     MoveList* moveList = nullptr;
-    int searchStartIndex = 0;
+    GenerationType type;
+    MovePickerStage stage;
+    int moveIndex = 0;
+    int capturesEnd = 0;
+    int badCapturesEnd = 0;
+    int killerIndex = 0;
+    // Moves that were returned before the moves were generated, so they can be skipped later
+    Move pickedMoves[6]{};
+    int pickedMoveCount = 0;
 
-public:
-    MovePicker() = delete;
+    bool isPicked(Move move) const;
 
-    MovePicker(MoveList* moveList)
-        : moveList(moveList) {
-    };
+    bool pickMove(Move move, bool quietOnly);
 
-    Move getNextMove();
+    Move selectBestMove(int endIndex);
 
-    bool hasNext();
+    bool isBadCapture(Move move);
+
+    void scoreAllMoves();
+
+public:
+    MovePicker(ThreadData& thread, GenerationType type);
 
-    int size();
+    MovePicker(MovePicker& other) = delete;
 
-    int remaining();
+    void operator=(const MovePicker&) = delete;
 
-    int movesSearched();
+    bool getNextMove(Move& move);
 };
-} // namespace Zagreus
\ No newline at end of file
+} // namespace Zagreus
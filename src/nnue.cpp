@@ -0,0 +1,212 @@
+/*
+ This file is part of Zagreus.
+
+ Zagreus is a UCI chess engine
+ Copyright (C) 2023-2024  Danny Jelsma
+
+ Zagreus is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published
+ by the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Zagreus is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with Zagreus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "nnue.h"
+
+#include <algorithm>
+#include <fstream>
+
+#if defined(__AVX512BW__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace Zagreus {
+struct alignas(64) Network {
+    int16_t featureWeights[NNUE_INPUT_SIZE][NNUE_HIDDEN_SIZE];
+    int16_t featureBiases[NNUE_HIDDEN_SIZE];
+    int16_t outputWeights[2 * NNUE_HIDDEN_SIZE];
+    int16_t outputBias;
+};
+
+static Network network{};
+static bool networkLoaded = false;
+static bool nnueEnabled = false;
+
+bool loadNetwork(const std::string& filePath) {
+    std::ifstream file(filePath, std::ios::binary);
+
+    if (!file) {
+        return false;
+    }
+
+    return loadNetwork(file);
+}
+
+bool loadNetwork(std::istream& stream) {
+    static Network newNetwork{};
+
+    stream.read(reinterpret_cast<char*>(newNetwork.featureWeights),
+                sizeof(newNetwork.featureWeights));
+    stream.read(reinterpret_cast<char*>(newNetwork.featureBiases),
+                sizeof(newNetwork.featureBiases));
+    stream.read(reinterpret_cast<char*>(newNetwork.outputWeights),
+                sizeof(newNetwork.outputWeights));
+    stream.read(reinterpret_cast<char*>(&newNetwork.outputBias), sizeof(newNetwork.outputBias));
+
+    // Reject truncated files and files with trailing data, most likely a different architecture
+    if (!stream || stream.peek() != std::char_traits<char>::eof()) {
+        return false;
+    }
+
+    network = newNetwork;
+    networkLoaded = true;
+    return true;
+}
+
+bool isNetworkLoaded() { return networkLoaded; }
+
+bool isNnueEnabled() { return nnueEnabled; }
+
+void setNnueEnabled(bool enabled) { nnueEnabled = enabled && networkLoaded; }
+
+static int getFeatureIndex(PieceColor perspective, PieceType piece, int8_t square) {
+    PieceColor pieceColor = static_cast<PieceColor>(piece % 2);
+    int relativeSquare = perspective == WHITE ? square : square ^ 56;
+    int side = pieceColor == perspective ? 0 : 1;
+
+    return side * 6 * SQUARES + (piece / 2) * SQUARES + relativeSquare;
+}
+
+#if defined(__AVX512BW__)
+using Vector = __m512i;
+static constexpr int VECTOR_SIZE = 32;
+
+static Vector loadVector(const int16_t* data) { return _mm512_load_si512(data); }
+static void storeVector(int16_t* data, Vector vector) { _mm512_store_si512(data, vector); }
+static Vector addVectors(Vector a, Vector b) { return _mm512_add_epi16(a, b); }
+static Vector subtractVectors(Vector a, Vector b) { return _mm512_sub_epi16(a, b); }
+static Vector clampVector(Vector vector, Vector min, Vector max) {
+    return _mm512_min_epi16(_mm512_max_epi16(vector, min), max);
+}
+static Vector setVector(int16_t value) { return _mm512_set1_epi16(value); }
+static Vector zeroVector() { return _mm512_setzero_si512(); }
+static Vector multiplyAdd(Vector a, Vector b) { return _mm512_madd_epi16(a, b); }
+static Vector addVectors32(Vector a, Vector b) { return _mm512_add_epi32(a, b); }
+static int32_t sumVector32(Vector vector) { return _mm512_reduce_add_epi32(vector); }
+#elif defined(__AVX2__)
+using Vector = __m256i;
+static constexpr int VECTOR_SIZE = 16;
+
+static Vector loadVector(const int16_t* data) {
+    return _mm256_load_si256(reinterpret_cast<const __m256i*>(data));
+}
+static void storeVector(int16_t* data, Vector vector) {
+    _mm256_store_si256(reinterpret_cast<__m256i*>(data), vector);
+}
+static Vector addVectors(Vector a, Vector b) { return _mm256_add_epi16(a, b); }
+static Vector subtractVectors(Vector a, Vector b) { return _mm256_sub_epi16(a, b); }
+static Vector clampVector(Vector vector, Vector min, Vector max) {
+    return _mm256_min_epi16(_mm256_max_epi16(vector, min), max);
+}
+static Vector setVector(int16_t value) { return _mm256_set1_epi16(value); }
+static Vector zeroVector() { return _mm256_setzero_si256(); }
+static Vector multiplyAdd(Vector a, Vector b) { return _mm256_madd_epi16(a, b); }
+static Vector addVectors32(Vector a, Vector b) { return _mm256_add_epi32(a, b); }
+static int32_t sumVector32(Vector vector) {
+    __m128i sum =
+        _mm_add_epi32(_mm256_castsi256_si128(vector), _mm256_extracti128_si256(vector, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sum);
+}
+#endif
+
+static void addWeights(int16_t* values, const int16_t* weights) {
+#if defined(__AVX512BW__) || defined(__AVX2__)
+    for (int i = 0; i < NNUE_HIDDEN_SIZE; i += VECTOR_SIZE) {
+        storeVector(&values[i], addVectors(loadVector(&values[i]), loadVector(&weights[i])));
+    }
+#else
+    for (int i = 0; i < NNUE_HIDDEN_SIZE; i++) {
+        values[i] += weights[i];
+    }
+#endif
+}
+
+static void subtractWeights(int16_t* values, const int16_t* weights) {
+#if defined(__AVX512BW__) || defined(__AVX2__)
+    for (int i = 0; i < NNUE_HIDDEN_SIZE; i += VECTOR_SIZE) {
+        storeVector(&values[i], subtractVectors(loadVector(&values[i]), loadVector(&weights[i])));
+    }
+#else
+    for (int i = 0; i < NNUE_HIDDEN_SIZE; i++) {
+        values[i] -= weights[i];
+    }
+#endif
+}
+
+// Dot product of the clipped ReLU of the accumulator values with the output weights
+static int32_t activateAndMultiply(const int16_t* values, const int16_t* weights) {
+#if defined(__AVX512BW__) || defined(__AVX2__)
+    const Vector min = zeroVector();
+    const Vector max = setVector(NNUE_QA);
+    Vector sum = zeroVector();
+
+    for (int i = 0; i < NNUE_HIDDEN_SIZE; i += VECTOR_SIZE) {
+        Vector activated = clampVector(loadVector(&values[i]), min, max);
+        sum = addVectors32(sum, multiplyAdd(activated, loadVector(&weights[i])));
+    }
+
+    return sumVector32(sum);
+#else
+    int32_t sum = 0;
+
+    for (int i = 0; i < NNUE_HIDDEN_SIZE; i++) {
+        int32_t activated = std::clamp<int32_t>(values[i], 0, NNUE_QA);
+        sum += activated * weights[i];
+    }
+
+    return sum;
+#endif
+}
+
+void resetAccumulator(Accumulator& accumulator) {
+    for (int16_t* values : accumulator.values) {
+        std::copy_n(network.featureBiases, NNUE_HIDDEN_SIZE, values);
+    }
+}
+
+void addFeature(Accumulator& accumulator, PieceType piece, int8_t square) {
+    addWeights(accumulator.values[WHITE],
+               network.featureWeights[getFeatureIndex(WHITE, piece, square)]);
+    addWeights(accumulator.values[BLACK],
+               network.featureWeights[getFeatureIndex(BLACK, piece, square)]);
+}
+
+void removeFeature(Accumulator& accumulator, PieceType piece, int8_t square) {
+    subtractWeights(accumulator.values[WHITE],
+                    network.featureWeights[getFeatureIndex(WHITE, piece, square)]);
+    subtractWeights(accumulator.values[BLACK],
+                    network.featureWeights[getFeatureIndex(BLACK, piece, square)]);
+}
+
+int evaluateNnue(const Accumulator& accumulator, PieceColor color) {
+    PieceColor opponentColor = color == WHITE ? BLACK : WHITE;
+    int32_t output = activateAndMultiply(accumulator.values[color], network.outputWeights);
+
+    output += activateAndMultiply(accumulator.values[opponentColor],
+                                  network.outputWeights + NNUE_HIDDEN_SIZE);
+    output += network.outputBias;
+
+    int score = static_cast<int>(static_cast<int64_t>(output) * NNUE_SCALE / (NNUE_QA * NNUE_QB));
+
+    // Never return something that could be mistaken for a mate score
+    return std::clamp(score, -(MATE_SCORE - MAX_PLY - 1), MATE_SCORE - MAX_PLY - 1);
+}
+} // namespace Zagreus
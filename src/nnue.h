@@ -0,0 +1,67 @@
+/*
+ This file is part of Zagreus.
+
+ Zagreus is a UCI chess engine
+ Copyright (C) 2023-2024  Danny Jelsma
+
+ Zagreus is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published
+ by the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Zagreus is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with Zagreus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <string>
+
+#include "constants.h"
+#include "types.h"
+
+namespace Zagreus {
+// A small NNUE network with 768 inputs (piece type and color x square, from the point of view of
+// each side), one hidden layer of NNUE_HIDDEN_SIZE neurons per side with a clipped ReLU and a
+// single output. The first layer is kept up to date incrementally while moves are made.
+//
+// Network file layout, all values little endian int16:
+//   feature weights [768][NNUE_HIDDEN_SIZE], quantized by NNUE_QA
+//   feature biases [NNUE_HIDDEN_SIZE], quantized by NNUE_QA
+//   output weights [2 * NNUE_HIDDEN_SIZE] (side to move first), quantized by NNUE_QB
+//   output bias, quantized by NNUE_QA * NNUE_QB
+static constexpr int NNUE_INPUT_SIZE = 768;
+static constexpr int NNUE_HIDDEN_SIZE = 256;
+static constexpr int NNUE_QA = 255;
+static constexpr int NNUE_QB = 64;
+static constexpr int NNUE_SCALE = 400;
+
+struct alignas(64) Accumulator {
+    int16_t values[COLORS][NNUE_HIDDEN_SIZE]{};
+};
+
+bool loadNetwork(const std::string& filePath);
+
+bool loadNetwork(std::istream& stream);
+
+bool isNetworkLoaded();
+
+// Whether the search uses the network instead of the hand-crafted evaluation
+bool isNnueEnabled();
+
+void setNnueEnabled(bool enabled);
+
+void resetAccumulator(Accumulator& accumulator);
+
+void addFeature(Accumulator& accumulator, PieceType piece, int8_t square);
+
+void removeFeature(Accumulator& accumulator, PieceType piece, int8_t square);
+
+int evaluateNnue(const Accumulator& accumulator, PieceColor color);
+} // namespace Zagreus
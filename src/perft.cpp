@@ -0,0 +1,97 @@
+/*
+ This file is part of Zagreus.
+
+ Zagreus is a UCI chess engine
+ Copyright (C) 2023-2024  Danny Jelsma
+
+ Zagreus is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published
+ by the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Zagreus is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with Zagreus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "perft.h"
+
+#include <cmath>
+
+#include "movegen.h"
+
+namespace Zagreus {
+// The data holds the depth in the lowest 8 bits and the node count in the other 56 bits
+PerftTable::PerftTable(int megaBytes) {
+    if ((megaBytes & (megaBytes - 1)) != 0) {
+        megaBytes = 1 << static_cast<int>(log2(megaBytes));
+    }
+
+    uint64_t slotCount = static_cast<uint64_t>(megaBytes) * 1024 * 1024 / sizeof(PerftSlot);
+
+    slots = new PerftSlot[slotCount]{};
+    slotMask = slotCount - 1;
+}
+
+bool PerftTable::probe(uint64_t zobristHash, int depth, uint64_t& nodes) {
+    PerftSlot& slot = slots[zobristHash & slotMask];
+    uint64_t data = slot.data.load(std::memory_order_relaxed);
+
+    if ((slot.key.load(std::memory_order_relaxed) ^ data) != zobristHash
+        || static_cast<int>(data & 0xFF) != depth) {
+        return false;
+    }
+
+    nodes = data >> 8;
+    return true;
+}
+
+void PerftTable::store(uint64_t zobristHash, int depth, uint64_t nodes) {
+    PerftSlot& slot = slots[zobristHash & slotMask];
+    uint64_t data = nodes << 8 | static_cast<uint64_t>(depth);
+
+    slot.key.store(zobristHash ^ data, std::memory_order_relaxed);
+    slot.data.store(data, std::memory_order_relaxed);
+}
+
+template <PieceColor color>
+uint64_t bulkPerft(ThreadData& thread, int depth, PerftTable& table) {
+    constexpr PieceColor OPPOSITE_COLOR = color == WHITE ? BLACK : WHITE;
+    Bitboard& board = thread.board;
+    uint64_t nodes = 0;
+
+    if (depth <= 0) {
+        return 1;
+    }
+
+    if (depth > 1 && table.probe(board.getZobristHash(), depth, nodes)) {
+        return nodes;
+    }
+
+    MoveList* moveList = thread.getMoveList(board.getPly());
+    generateMoves<color, NORMAL>(board, moveList);
+
+    // Only legal moves are generated, so the last ply does not have to be made
+    if (depth == 1) {
+        return moveList->size;
+    }
+
+    for (int i = 0; i < moveList->size; i++) {
+        Move move = moveList->moves[i];
+
+        board.makeMove(move);
+        nodes += bulkPerft<OPPOSITE_COLOR>(thread, depth - 1, table);
+        board.unmakeMove(move);
+    }
+
+    table.store(board.getZobristHash(), depth, nodes);
+    return nodes;
+}
+
+template uint64_t bulkPerft<WHITE>(ThreadData& thread, int depth, PerftTable& table);
+template uint64_t bulkPerft<BLACK>(ThreadData& thread, int depth, PerftTable& table);
+} // namespace Zagreus
@@ -0,0 +1,61 @@
+/*
+ This file is part of Zagreus.
+
+ Zagreus is a UCI chess engine
+ Copyright (C) 2023-2024  Danny Jelsma
+
+ Zagreus is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published
+ by the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Zagreus is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with Zagreus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "thread_data.h"
+#include "types.h"
+
+namespace Zagreus {
+// The key is stored XOR'ed with the data, like in the transposition table, so a slot that was torn
+// by two threads writing to it at the same time fails validation instead of returning a wrong count.
+struct PerftSlot {
+    std::atomic<uint64_t> key{0};
+    std::atomic<uint64_t> data{0};
+};
+
+// Caches the leaf count of perft subtrees by zobrist hash and depth. Shared by all perft threads.
+class PerftTable {
+private:
+    PerftSlot* slots = nullptr;
+    uint64_t slotMask = 0;
+
+public:
+    explicit PerftTable(int megaBytes);
+
+    ~PerftTable() { delete[] slots; }
+
+    PerftTable(PerftTable& other) = delete;
+
+    void operator=(const PerftTable&) = delete;
+
+    bool probe(uint64_t zobristHash, int depth, uint64_t& nodes);
+
+    void store(uint64_t zobristHash, int depth, uint64_t nodes);
+};
+
+// Counts the leaf nodes below the position on the board of the thread. The moves of the last ply
+// are counted straight from the generated move list, without making them.
+template <PieceColor color>
+uint64_t bulkPerft(ThreadData& thread, int depth, PerftTable& table);
+} // namespace Zagreus
@@ -23,18 +23,43 @@
 #include <cmath>
 
 #include "../senjo/Output.h"
+#include "eval_cache.h"
 #include "evaluate.h"
 #include "features.h"
 #include "movegen.h"
-#include "movelist_pool.h"
 #include "movepicker.h"
+#include "nnue.h"
 #include "timemanager.h"
 #include "tt.h"
 
 namespace Zagreus {
 TranspositionTable* tt = TranspositionTable::getTT();
+EvalCache* evalCache = EvalCache::getEvalCache();
 static int lmrReductions[MAX_PLY][MAX_MOVES]{};
 
+// Returns the static evaluation of the current position, only evaluating it when it is not already
+// in the eval cache
+static int evaluatePosition(ThreadData& thread) {
+    uint64_t zobristHash = thread.board.getZobristHash();
+    int score;
+
+    if (evalCache->probe(zobristHash, score)) {
+        thread.evalCacheHits += 1;
+        return score;
+    }
+
+    thread.evalCacheMisses += 1;
+
+    if (isNnueEnabled()) {
+        score = evaluateNnue(thread.board.getAccumulator(), thread.board.getMovingColor());
+    } else {
+        score = Evaluation(thread.board, thread.pawnTable).evaluate();
+    }
+
+    evalCache->store(zobristHash, score);
+    return score;
+}
+
 void initializeSearch() {
     for (int depth = 0; depth < MAX_PLY; depth++) {
         for (int movesPlayed = 0; movesPlayed < MAX_MOVES; movesPlayed++) {
@@ -45,31 +70,91 @@ void initializeSearch() {
     }
 }
 
+static bool shouldStopSearch(ThreadData& thread, SearchContext& context) {
+    if (thread.searchStopped) {
+        return true;
+    }
+
+    // Checked at every node, so the search stops at exactly the node limit. Nodes are only counted
+    // after this check.
+    if (context.nodeLimit > 0
+        && thread.searchStats.nodes + thread.searchStats.qnodes >= context.nodeLimit) {
+        thread.searchStopped = true;
+        return true;
+    }
+
+    if (--thread.nodesUntilStopCheck > 0) {
+        return false;
+    }
+
+    thread.nodesUntilStopCheck = STOP_CHECK_INTERVAL;
+    thread.publishNodes();
+
+    // After a ponderhit the search continues, now with the normal time limits
+    if (context.pondering && !context.engine->isPondering()) {
+        updateTimeLimits(context, *context.params, *context.engine, context.rootColor);
+    }
+
+    thread.searchStopped = context.engine->stopRequested()
+                           || std::chrono::steady_clock::now() > context.endTime;
+
+    return thread.searchStopped;
+}
+
 template <PieceColor color>
-Move getBestMove(senjo::GoParams params, ZagreusEngine& engine, Bitboard& board,
-                 senjo::SearchStats& searchStats) {
-    MoveListPool* moveListPool = MoveListPool::getInstance();
+Move getBestMove(senjo::GoParams params, ZagreusEngine& engine, ThreadData& thread) {
+    Bitboard& board = thread.board;
+    senjo::SearchStats& searchStats = thread.searchStats;
     auto startTime = std::chrono::steady_clock::now();
     SearchContext searchContext{};
     searchContext.startTime = startTime;
-    int depth = 0;
+    searchContext.engine = &engine;
+    searchContext.rootPly = board.getPly();
+    searchContext.params = &params;
+    searchContext.rootColor = color;
+    searchContext.pondering = thread.isMainThread() && engine.isPondering();
+
+    // The node budget is split over the threads, so the total stays within it. With one thread, the
+    // search is stopped at exactly the requested number of nodes.
+    if (params.nodes > 0) {
+        uint64_t threadCount = engine.getOption("Threads").getIntValue();
+        searchContext.nodeLimit = std::max<uint64_t>(params.nodes / threadCount, 1);
+    }
+
+    // Helper threads start at alternating depths, so they don't all search the same tree
+    int depth = thread.threadId % 2;
     int bestScore = MAX_NEGATIVE;
+    int previousScore = 0;
+    int rootPly = board.getPly();
     Line bestPvLine{};
     Line pvLine{};
-    pvLine.startPly = board.getPly();
 
-    tt->ageHistoryTable();
+    thread.ageHistoryTable();
+    thread.searchStopped = false;
+    thread.nodesUntilStopCheck = STOP_CHECK_INTERVAL;
 
     while (!engine.stopRequested()) {
-        // Update the endtime using new data
-        searchContext.endTime = getEndTime(searchContext, params, engine, board.getMovingColor());
-
-        auto currentTime = std::chrono::steady_clock::now();
-        if (currentTime > searchContext.endTime) {
-            engine.stopSearching();
-            break;
+        // Update the time limits using new data. Only the main thread manages the time, the helper
+        // threads search until the main thread tells them to stop.
+        if (thread.isMainThread()) {
+            updateTimeLimits(searchContext, params, engine, board.getMovingColor());
+
+            // Without a completed iteration there is no move to play, so the first one is always
+            // started
+            if (bestPvLine.moveCount > 0 && !canStartIteration(searchContext)) {
+                engine.stopSearching();
+                break;
+            }
+        } else {
+            searchContext.softEndTime = std::chrono::time_point<std::chrono::steady_clock>::max();
+            searchContext.endTime = std::chrono::time_point<std::chrono::steady_clock>::max();
         }
 
+        auto iterationStartTime = std::chrono::steady_clock::now();
+        uint64_t iterationStartNodes = searchStats.nodes + searchStats.qnodes;
+        // Only set when a root move raises alpha, which does not happen on a fail low
+        searchContext.bestMoveNodes = 0;
+
         depth += 1;
         searchStats.depth = depth;
         searchStats.seldepth = 0;
@@ -80,20 +165,76 @@ Move getBestMove(senjo::GoParams params, ZagreusEngine& engine, Bitboard& board,
 
         // If the go command has a max depth argument, terminate when reaching the desired depth.
         if (params.depth > 0 && depth > params.depth) {
-            return pvLine.moves[0];
+            break;
+        }
+
+        // Search with a window around the score of the previous iteration first, and widen the
+        // side that failed until the score falls inside the window. Mate scores keep growing
+        // between iterations, so those are searched with the full window.
+        int delta = ASPIRATION_DELTA;
+        int fails = 0;
+        int alpha = MAX_NEGATIVE;
+        int beta = MAX_POSITIVE;
+        int score;
+
+        if (depth >= ASPIRATION_MIN_DEPTH && std::abs(previousScore) < MATE_SCORE - MAX_PLY) {
+            alpha = std::max(previousScore - delta, MAX_NEGATIVE);
+            beta = std::min(previousScore + delta, MAX_POSITIVE);
         }
 
-        int score = search<color, ROOT>(board, MAX_NEGATIVE, MAX_POSITIVE, depth, searchContext,
-                                        searchStats, pvLine);
+        while (true) {
+            score = search<color, ROOT>(thread, alpha, beta, depth, searchContext);
+            // After a fail low the root has no PV, the one of the previous iteration is kept
+            thread.copyPv(rootPly, pvLine);
+
+            if (std::chrono::steady_clock::now() > searchContext.endTime) {
+                engine.stopSearching();
+            }
+
+            if (thread.searchStopped || engine.stopRequested()
+                || (score > alpha && score < beta)) {
+                break;
+            }
+
+            if (score <= alpha) {
+                beta = (alpha + beta) / 2;
+                alpha = std::max(score - delta, MAX_NEGATIVE);
+                searchStats.upperbound = true;
+            } else {
+                beta = std::min(score + delta, MAX_POSITIVE);
+                searchStats.lowerbound = true;
+                // The root is not stored in the TT, so the move that failed high is passed on to the
+                // move ordering of the re-search through the PV
+                board.setPvLine(pvLine);
+            }
+
+            fails += 1;
+
+            if (fails >= ASPIRATION_MAX_FAILS) {
+                alpha = MAX_NEGATIVE;
+                beta = MAX_POSITIVE;
+            }
+
+            if (thread.isMainThread()) {
+                searchStats.score = score;
+                senjo::SearchStats totalStats = engine.getSearchStats();
+                printPv(totalStats, startTime, pvLine);
+            }
+
+            searchStats.lowerbound = false;
+            searchStats.upperbound = false;
+            delta *= 2;
+        }
 
-        currentTime = std::chrono::steady_clock::now();
-        if (currentTime > searchContext.endTime) {
-            engine.stopSearching();
+        // The iteration was aborted, so the PV can't be trusted
+        if (thread.searchStopped || engine.stopRequested()) {
             break;
         }
 
         Move bestMove = pvLine.moves[0];
-        Move previousBestMove = board.getPvLine().moves[0];
+        // The PV of the board is also set on an aspiration fail high, so it may already hold the
+        // move of this iteration
+        Move previousBestMove = bestPvLine.moves[0];
 
         // If bestScore is positive and iterationScore is 0 or negative or vice versa, set suddenScoreSwing to true
         if (depth > 1 && ((bestScore > 0 && score < 0) || (bestScore < 0 && score > 0))) {
@@ -105,31 +246,56 @@ Move getBestMove(senjo::GoParams params, ZagreusEngine& engine, Bitboard& board,
             searchContext.suddenScoreDrop = true;
         }
 
-        // If bestMove changes, increment context.pvChanges
-        if (depth > 1 && (bestMove.from != previousBestMove.from || bestMove.to != previousBestMove.
-                          to)) {
-            searchContext.pvChanges += 1;
+        if (bestMove == previousBestMove) {
+            searchContext.bestMoveStability += 1;
+        } else {
+            searchContext.bestMoveStability = 0;
         }
 
+        searchContext.previousIterationNodes = searchContext.iterationNodes;
+        searchContext.iterationNodes = searchStats.nodes + searchStats.qnodes - iterationStartNodes;
+        searchContext.iterationTime = std::chrono::steady_clock::now() - iterationStartTime;
+
         if (score > bestScore) {
             bestScore = score;
         }
 
+        previousScore = score;
+
         bestPvLine = pvLine;
         board.setPvLine(bestPvLine);
         searchStats.score = score;
-        printPv(searchStats, startTime, bestPvLine);
+
+        if (thread.isMainThread()) {
+            senjo::SearchStats totalStats = engine.getSearchStats();
+            printPv(totalStats, startTime, bestPvLine);
+        }
+
+        // Mate scores are MATE_SCORE minus the ply of the mated position, so this is the distance
+        // to the mate in plies
+        int matePlies = MATE_SCORE - score - rootPly;
+
+        if (params.mate > 0 && score >= MATE_SCORE - MAX_PLY && (matePlies + 1) / 2 <= params.mate) {
+            break;
+        }
+    }
+
+    thread.publishNodes();
+
+    if (thread.isMainThread()) {
+        // The best move may not be sent while pondering, so a search that finished on its own
+        // waits for the ponderhit or the stop command
+        engine.waitWhilePondering();
+        engine.stopSearching();
     }
 
-    engine.stopSearching();
     Move bestMove = bestPvLine.moves[0];
-    MoveList* legalMoves = moveListPool->getMoveList();
+    MoveList* legalMoves = thread.getMoveList(board.getPly());
     generateMoves<color, NORMAL>(board, legalMoves);
 
     // Check if bestMove is a legal move (sometimes in endgames that drag on for long time, the PV is empty)
     for (int i = 0; i < legalMoves->size; i++) {
-        if (legalMoves->moves[i].from == bestMove.from && legalMoves->moves[i].to == bestMove.to) {
-            moveListPool->releaseMoveList(legalMoves);
+        if (legalMoves->moves[i] == bestMove) {
             return bestMove;
         }
     }
@@ -137,26 +303,35 @@ Move getBestMove(senjo::GoParams params, ZagreusEngine& engine, Bitboard& board,
     return legalMoves->moves[0];
 }
 
-template Move getBestMove<WHITE>(senjo::GoParams params, ZagreusEngine& engine, Bitboard& board,
-                                 senjo::SearchStats& searchStats);
-template Move getBestMove<BLACK>(senjo::GoParams params, ZagreusEngine& engine, Bitboard& board,
-                                 senjo::SearchStats& searchStats);
+template Move getBestMove<WHITE>(senjo::GoParams params, ZagreusEngine& engine,
+                                 ThreadData& thread);
+template Move getBestMove<BLACK>(senjo::GoParams params, ZagreusEngine& engine,
+                                 ThreadData& thread);
 
 template <PieceColor color, NodeType nodeType>
-int search(Bitboard& board, int alpha, int beta, int16_t depth,
-           SearchContext& context,
-           senjo::SearchStats& searchStats, Line& pvLine) {
+int search(ThreadData& thread, int alpha, int beta, int16_t depth, SearchContext& context) {
     constexpr bool IS_PV_NODE = nodeType == PV || nodeType == ROOT;
     constexpr bool IS_ROOT_NODE = nodeType == ROOT;
     constexpr PieceColor OPPOSITE_COLOR = color == WHITE ? BLACK : WHITE;
+    Bitboard& board = thread.board;
+    senjo::SearchStats& searchStats = thread.searchStats;
 
-    if (board.isDraw()) {
+    thread.clearPv(board.getPly());
+
+    if (board.isDraw(context.rootPly)) {
         return DRAW_SCORE;
     }
 
-    auto currentTime = std::chrono::steady_clock::now();
-    if (!IS_ROOT_NODE && (currentTime > context.endTime || board.getPly() >= MAX_PLY)) {
-        pvLine.moveCount = 0;
+    // If a move back to a position in the search tree exists, the score is at least a draw
+    if (!IS_ROOT_NODE && alpha < DRAW_SCORE && board.hasUpcomingRepetition(context.rootPly)) {
+        alpha = DRAW_SCORE;
+
+        if (alpha >= beta) {
+            return alpha;
+        }
+    }
+
+    if (!IS_ROOT_NODE && (shouldStopSearch(thread, context) || board.getPly() >= MAX_PLY)) {
         return beta;
     }
 
@@ -164,7 +339,7 @@ int search(Bitboard& board, int alpha, int beta, int16_t depth,
 
     bool ownKingInCheck = board.isKingInCheck<color>();
     if (ownKingInCheck) {
-        int see = board.seeOpponent<OPPOSITE_COLOR>(board.getPreviousMove().to);
+        int see = board.seeOpponent<OPPOSITE_COLOR>(getToSquare(board.getPreviousMove()));
 
         if (see >= NO_CAPTURE_SCORE) {
             depth += 1;
@@ -172,8 +347,7 @@ int search(Bitboard& board, int alpha, int beta, int16_t depth,
     }
 
     if (depth <= 0) {
-        pvLine.moveCount = 0;
-        return qsearch<color, nodeType>(board, alpha, beta, depth, context, searchStats);
+        return qsearch<color, nodeType>(thread, alpha, beta, depth, context);
     }
 
     if (!IS_PV_NODE && board.getHalfMoveClock() < 80) {
@@ -191,16 +365,12 @@ int search(Bitboard& board, int alpha, int beta, int16_t depth,
     if (!IS_PV_NODE && depth >= 3 && !isPreviousMoveNull && board.
         getAmountOfMinorOrMajorPieces<
             color>() > 0) {
-        if (!ownKingInCheck && Evaluation(board).evaluate() >= beta) {
+        if (!ownKingInCheck && evaluatePosition(thread) >= beta) {
             int r = 3 + (depth >= 6) + (depth >= 12);
 
-            Line nullLine{};
-            SearchContext nullContext{};
-            nullContext.startTime = context.startTime;
-            nullContext.endTime = context.endTime;
             board.makeNullMove();
-            int nullScore = -search<OPPOSITE_COLOR, NULL_MOVE>(board, -beta, -beta + 1, depth - r,
-                                                               nullContext, searchStats, nullLine);
+            int nullScore = -search<OPPOSITE_COLOR, NULL_MOVE>(thread, -beta, -beta + 1, depth - r,
+                                                               context);
             board.unmakeNullMove();
             int mateScores = MATE_SCORE - MAX_PLY;
 
@@ -211,31 +381,19 @@ int search(Bitboard& board, int alpha, int beta, int16_t depth,
     }
 
     bool doPvSearch = true;
-    MoveListPool* moveListPool = MoveListPool::getInstance();
-    MoveList* moves = moveListPool->getMoveList();
-
-    if (ownKingInCheck) {
-        generateMoves<color, EVASIONS>(board, moves);
-    } else {
-        generateMoves<color, NORMAL>(board, moves);
-    }
-
-    auto movePicker = MovePicker(moves);
+    MovePicker<color> movePicker(thread, ownKingInCheck ? EVASIONS : NORMAL);
     int legalMoveCount = 0;
-    Line nodeLine{};
-    nodeLine.startPly = board.getPly();
     int bestScore = MAX_NEGATIVE;
-    Move bestMove = {NO_SQUARE, NO_SQUARE};
-
-    while (movePicker.hasNext()) {
-        Move move = movePicker.getNextMove();
-        board.makeMove(move);
+    Move bestMove = NO_MOVE;
+    Move move = NO_MOVE;
 
-        if (board.isKingInCheck<color>()) {
-            board.unmakeMove(move);
-            continue;
-        }
+    while (movePicker.getNextMove(move)) {
+        PieceType piece = board.getPieceOnSquare(getFromSquare(move));
+        bool isQuiet = board.isQuietMove(move);
+        uint64_t nodesBefore = thread.searchStats.nodes + thread.searchStats.qnodes;
 
+        tt->prefetch(board.getZobristHashAfterMove(move));
+        board.makeMove(move);
         legalMoveCount += 1;
 
         int score = 0;
@@ -243,8 +401,7 @@ int search(Bitboard& board, int alpha, int beta, int16_t depth,
         bool shouldFullSearch = false;
 
         // Late Move Reduction (LMR, not in Root nodes)
-        if (!IS_ROOT_NODE && depth >= 3 && move.captureScore == NO_CAPTURE_SCORE && move.
-            promotionPiece == EMPTY && legalMoveCount > 1) {
+        if (!IS_ROOT_NODE && depth >= 3 && isQuiet && legalMoveCount > 1) {
             int R = std::max(0, lmrReductions[depth][legalMoveCount]);
 
             // Increase reduction for non-PV nodes
@@ -254,15 +411,14 @@ int search(Bitboard& board, int alpha, int beta, int16_t depth,
             R -= ownKingInCheck;
 
             // Decrease reduction for killer moves
-            uint64_t moveCode = encodeMove(&move);
-            if (tt->killerMoves[0][board.getPly()] == moveCode
-                || tt->killerMoves[1][board.getPly()] == moveCode
-                || tt->killerMoves[2][board.getPly()] == moveCode) {
+            if (thread.killerMoves[0][board.getPly()] == move
+                || thread.killerMoves[1][board.getPly()] == move
+                || thread.killerMoves[2][board.getPly()] == move) {
                 R -= 1;
             }
 
             // Decrease for counter moves
-            if (tt->counterMoves[move.piece][move.to] == moveCode) {
+            if (thread.counterMoves[piece][getToSquare(move)] == move) {
                 R -= 1;
             }
 
@@ -271,8 +427,8 @@ int search(Bitboard& board, int alpha, int beta, int16_t depth,
 
             // Depth - 1 (R = 1) is the "default" search, so skip LMR
             if (R > 1) {
-                score = -search<OPPOSITE_COLOR, NO_PV>(
-                    board, -alpha - 1, -alpha, depth - R, context, searchStats, nodeLine);
+                score = -search<OPPOSITE_COLOR, NO_PV>(thread, -alpha - 1, -alpha, depth - R,
+                                                       context);
 
                 didLmr = true;
 
@@ -284,65 +440,68 @@ int search(Bitboard& board, int alpha, int beta, int16_t depth,
 
         if (!didLmr || shouldFullSearch) {
             if (IS_PV_NODE && doPvSearch) {
-                score = -search<OPPOSITE_COLOR, PV>(board, -beta, -alpha, depth - 1,
-                                                    context,
-                                                    searchStats, nodeLine);
+                score = -search<OPPOSITE_COLOR, PV>(thread, -beta, -alpha, depth - 1, context);
             } else {
-                score = -search<OPPOSITE_COLOR, NO_PV>(board, -alpha - 1, -alpha,
-                                                       depth - 1, context,
-                                                       searchStats, nodeLine);
+                score = -search<OPPOSITE_COLOR, NO_PV>(thread, -alpha - 1, -alpha,
+                                                       depth - 1, context);
 
                 if (score > alpha && score < beta) {
-                    score = -search<OPPOSITE_COLOR, PV>(board, -beta, -alpha,
-                                                        depth - 1, context,
-                                                        searchStats, nodeLine);
+                    score = -search<OPPOSITE_COLOR, PV>(thread, -beta, -alpha,
+                                                        depth - 1, context);
                 }
             }
         }
 
         board.unmakeMove(move);
 
+        // The subtree was not searched completely, so its score can't be used or stored in the TT
+        if (thread.searchStopped) {
+            return beta;
+        }
+
         if (score > bestScore) {
             bestScore = score;
 
             if (score > alpha) {
                 bestMove = move;
+                thread.updatePv(board.getPly(), move);
+
+                // The share of the nodes spent on the best root move is used by the time manager
+                if (IS_ROOT_NODE) {
+                    context.bestMoveNodes = thread.searchStats.nodes + thread.searchStats.qnodes
+                                            - nodesBefore;
+                }
 
                 if (score >= beta) {
-                    if (move.captureScore == NO_CAPTURE_SCORE && move.promotionPiece == EMPTY) {
-                        uint64_t moveCode = encodeMove(&move);
-                        tt->killerMoves[2][board.getPly()] = tt->killerMoves[1][board.getPly()];
-                        tt->killerMoves[1][board.getPly()] = tt->killerMoves[0][board.getPly()];
-                        tt->killerMoves[0][board.getPly()] = moveCode;
-                        tt->historyMoves[move.piece][move.to] += depth * depth;
-
-                        if (!isPreviousMoveNull) {
-                            tt->counterMoves[board.getPreviousMove().piece][board.getPreviousMove().
-                                to] = moveCode;
+                    if (isQuiet) {
+                        int ply = board.getPly();
+                        thread.killerMoves[2][ply] = thread.killerMoves[1][ply];
+                        thread.killerMoves[1][ply] = thread.killerMoves[0][ply];
+                        thread.killerMoves[0][ply] = move;
+                        thread.historyMoves[piece][getToSquare(move)] += depth * depth;
+
+                        Move previousMove = board.getPreviousMove();
+
+                        if (!isPreviousMoveNull && previousMove != NO_MOVE) {
+                            int8_t previousTo = getToSquare(previousMove);
+                            PieceType previousPiece = board.getPieceOnSquare(previousTo);
+                            thread.counterMoves[previousPiece][previousTo] = move;
                         }
                     }
 
-                    moveListPool->releaseMoveList(moves);
                     if (!IS_ROOT_NODE) {
-                        uint32_t bestMoveCode = encodeMove(&bestMove);
                         tt->addPosition(board.getZobristHash(), depth, score, FAIL_HIGH_NODE,
-                                        bestMoveCode, board.getPly(), context);
+                                        bestMove, board.getPly());
                     }
                     return score;
                 }
 
                 alpha = score;
                 doPvSearch = false;
-
-                pvLine.moves[0] = move;
-                std::memcpy(pvLine.moves + 1, nodeLine.moves, nodeLine.moveCount * sizeof(Move));
-                pvLine.moveCount = nodeLine.moveCount + 1;
             }
         }
     }
 
-    moveListPool->releaseMoveList(moves);
-
     if (!legalMoveCount) {
         if (ownKingInCheck) {
             alpha = -MATE_SCORE + board.getPly();
@@ -353,32 +512,38 @@ int search(Bitboard& board, int alpha, int beta, int16_t depth,
 
     TTNodeType ttNodeType = FAIL_LOW_NODE;
 
-    if (IS_PV_NODE && (bestMove.from != NO_SQUARE && bestMove.to != NO_SQUARE)) {
+    if (IS_PV_NODE && bestMove != NO_MOVE) {
         ttNodeType = EXACT_NODE;
     }
 
     if (!IS_ROOT_NODE) {
-        uint32_t bestMoveCode = encodeMove(&bestMove);
-        tt->addPosition(board.getZobristHash(), depth, alpha, ttNodeType, board.getPly(),
-                        bestMoveCode, context);
+        tt->addPosition(board.getZobristHash(), depth, alpha, ttNodeType, bestMove,
+                        board.getPly());
     }
 
     return alpha;
 }
 
 template <PieceColor color, NodeType nodeType>
-int qsearch(Bitboard& board, int alpha, int beta, int16_t depth,
-            SearchContext& context,
-            senjo::SearchStats& searchStats) {
+int qsearch(ThreadData& thread, int alpha, int beta, int16_t depth, SearchContext& context) {
     constexpr PieceColor OPPOSITE_COLOR = color == WHITE ? BLACK : WHITE;
     constexpr TTNodeType IS_PV_NODE = nodeType == PV ? EXACT_NODE : FAIL_LOW_NODE;
+    Bitboard& board = thread.board;
+    senjo::SearchStats& searchStats = thread.searchStats;
 
-    if (board.isDraw()) {
+    if (board.isDraw(context.rootPly)) {
         return DRAW_SCORE;
     }
 
-    auto currentTime = std::chrono::steady_clock::now();
-    if (currentTime > context.endTime || board.getPly() >= MAX_PLY) {
+    if (alpha < DRAW_SCORE && board.hasUpcomingRepetition(context.rootPly)) {
+        alpha = DRAW_SCORE;
+
+        if (alpha >= beta) {
+            return alpha;
+        }
+    }
+
+    if (shouldStopSearch(thread, context) || board.getPly() >= MAX_PLY) {
         return beta;
     }
 
@@ -397,11 +562,11 @@ int qsearch(Bitboard& board, int alpha, int beta, int16_t depth,
     Move previousMove = board.getPreviousMove();
 
     if (!inCheck) {
-        int standPat = Evaluation(board).evaluate();
+        int standPat = evaluatePosition(thread);
 
         if (standPat >= beta) {
             tt->addPosition(board.getZobristHash(), depth, standPat, FAIL_HIGH_NODE, 0,
-                            board.getPly(), context);
+                            board.getPly());
             return standPat;
         }
 
@@ -413,8 +578,9 @@ int qsearch(Bitboard& board, int alpha, int beta, int16_t depth,
             int minPawnValue = std::min(getEvalValue(ENDGAME_PAWN_MATERIAL),
                                         getEvalValue(MIDGAME_PAWN_MATERIAL));
 
-            if (previousMove.promotionPiece != EMPTY) {
-                queenDelta += getPieceWeight(previousMove.promotionPiece) - minPawnValue;
+            if (isPromotion(previousMove)) {
+                queenDelta += getPieceWeight(getPromotionPiece(previousMove, OPPOSITE_COLOR))
+                    - minPawnValue;
             }
 
             if (standPat < alpha - queenDelta) {
@@ -427,41 +593,24 @@ int qsearch(Bitboard& board, int alpha, int beta, int16_t depth,
         }
     }
 
-    MoveListPool* moveListPool = MoveListPool::getInstance();
-    MoveList* moves = moveListPool->getMoveList();
-
-    if (inCheck) {
-        generateMoves<color, EVASIONS>(board, moves);
-    } else {
-        generateMoves<color, QSEARCH>(board, moves);
-    }
-
-    auto movePicker = MovePicker(moves);
+    MovePicker<color> movePicker(thread, inCheck ? EVASIONS : QSEARCH);
     int legalMoveCount = 0;
-    previousMove = {};
     int bestScore = MAX_NEGATIVE;
-    Move bestMove = {NO_SQUARE, NO_SQUARE};
-
-    while (movePicker.hasNext()) {
-        Move move = movePicker.getNextMove();
-
-        if (!inCheck && move.captureScore < NO_CAPTURE_SCORE) {
-            continue;
-        }
+    Move bestMove = NO_MOVE;
+    Move move = NO_MOVE;
 
+    while (movePicker.getNextMove(move)) {
+        tt->prefetch(board.getZobristHashAfterMove(move));
         board.makeMove(move);
-
-        if (board.isKingInCheck<color>()) {
-            board.unmakeMove(move);
-            continue;
-        }
-
         legalMoveCount += 1;
 
-        int score = -qsearch<OPPOSITE_COLOR, nodeType>(board, -beta, -alpha, depth - 1, context,
-                                                       searchStats);
+        int score = -qsearch<OPPOSITE_COLOR, nodeType>(thread, -beta, -alpha, depth - 1, context);
         board.unmakeMove(move);
 
+        if (thread.searchStopped) {
+            return beta;
+        }
+
         if (score > bestScore) {
             bestScore = score;
 
@@ -469,10 +618,8 @@ int qsearch(Bitboard& board, int alpha, int beta, int16_t depth,
                 bestMove = move;
 
                 if (score >= beta) {
-                    moveListPool->releaseMoveList(moves);
-                    uint32_t bestMoveCode = encodeMove(&bestMove);
                     tt->addPosition(board.getZobristHash(), depth, score, FAIL_HIGH_NODE,
-                                    bestMoveCode, board.getPly(), context);
+                                    bestMove, board.getPly());
                     return beta;
                 }
 
@@ -481,49 +628,30 @@ int qsearch(Bitboard& board, int alpha, int beta, int16_t depth,
         }
     }
 
-    moveListPool->releaseMoveList(moves);
-
     if (legalMoveCount == 0 && inCheck) {
         return -MATE_SCORE + board.getPly();
     }
 
     TTNodeType ttNodeType = FAIL_LOW_NODE;
 
-    if (IS_PV_NODE && (bestMove.from != NO_SQUARE && bestMove.to != NO_SQUARE)) {
+    if (IS_PV_NODE && bestMove != NO_MOVE) {
         ttNodeType = EXACT_NODE;
     }
 
-    uint32_t bestMoveCode = encodeMove(&bestMove);
-    tt->addPosition(board.getZobristHash(), depth, alpha, ttNodeType, bestMoveCode, board.getPly(),
-                    context);
+    tt->addPosition(board.getZobristHash(), depth, alpha, ttNodeType, bestMove, board.getPly());
     return alpha;
 }
 
-template int qsearch<WHITE, PV>(Bitboard& board, int alpha, int beta,
-                                int16_t depth, SearchContext& context,
-                                senjo::SearchStats& searchStats);
-template int qsearch<BLACK, PV>(Bitboard& board, int alpha, int beta,
-                                int16_t depth, SearchContext& context,
-                                senjo::SearchStats& searchStats);
+template int qsearch<WHITE, PV>(ThreadData& thread, int alpha, int beta, int16_t depth,
+                                SearchContext& context);
+template int qsearch<BLACK, PV>(ThreadData& thread, int alpha, int beta, int16_t depth,
+                                SearchContext& context);
 
 void printPv(senjo::SearchStats& searchStats, std::chrono::steady_clock::time_point& startTime,
              Line& pvLine) {
     searchStats.pv = "";
     for (int i = 0; i < pvLine.moveCount; i++) {
-        Move move = pvLine.moves[i];
-        searchStats.pv += getNotation(move.from) + getNotation(move.to);
-
-        if (move.promotionPiece != EMPTY) {
-            if (move.promotionPiece == WHITE_QUEEN || move.promotionPiece == BLACK_QUEEN) {
-                searchStats.pv += "q";
-            } else if (move.promotionPiece == WHITE_ROOK || move.promotionPiece == BLACK_ROOK) {
-                searchStats.pv += "r";
-            } else if (move.promotionPiece == WHITE_BISHOP || move.promotionPiece == BLACK_BISHOP) {
-                searchStats.pv += "b";
-            } else if (move.promotionPiece == WHITE_KNIGHT || move.promotionPiece == BLACK_KNIGHT) {
-                searchStats.pv += "n";
-            }
-        }
+        searchStats.pv += getMoveNotation(pvLine.moves[i]);
 
         if (i != pvLine.moveCount - 1) {
             searchStats.pv += " ";
@@ -23,14 +23,35 @@
 
 #include "bitboard.h"
 #include "engine.h"
+#include "thread_data.h"
 #include "types.h"
 #include "../senjo/GoParams.h"
 
 namespace Zagreus {
 struct SearchContext {
     std::chrono::time_point<std::chrono::steady_clock> startTime;
+    // The hard time limit, the search is aborted when it is reached
     std::chrono::time_point<std::chrono::steady_clock> endTime;
-    int pvChanges = 0;
+    // The soft time limit, no new iteration is started after it
+    std::chrono::time_point<std::chrono::steady_clock> softEndTime;
+    ZagreusEngine* engine = nullptr;
+    // The go parameters and the side to move at the root, used by the time manager
+    senjo::GoParams* params = nullptr;
+    PieceColor rootColor = WHITE;
+    // True while searching on the opponent's time. The clock only starts at the ponderhit.
+    bool pondering = false;
+    // The ply of the root position, to tell repetitions in the search tree apart from the game
+    int rootPly = 0;
+    // The number of nodes this thread may search, 0 if there is no limit
+    uint64_t nodeLimit = 0;
+    // The number of iterations in a row that ended with the same best move
+    int bestMoveStability = 0;
+    // The nodes spent on the best root move, on the last iteration and on the one before it, and
+    // the duration of the last iteration. Used to scale the time and to predict the next iteration.
+    uint64_t bestMoveNodes = 0;
+    uint64_t iterationNodes = 0;
+    uint64_t previousIterationNodes = 0;
+    std::chrono::steady_clock::duration iterationTime{};
     // A boolean variable that keeps track if the score suddenly went from positive to negative or
     // vice versa
     bool suddenScoreSwing = false;
@@ -41,18 +62,13 @@ struct SearchContext {
 void initializeSearch();
 
 template <PieceColor color>
-Move getBestMove(senjo::GoParams params, ZagreusEngine& engine, Bitboard& board,
-                 senjo::SearchStats& searchStats);
+Move getBestMove(senjo::GoParams params, ZagreusEngine& engine, ThreadData& thread);
 
 template <PieceColor color, NodeType nodeType>
-int search(Bitboard& board, int alpha, int beta, int16_t depth,
-           SearchContext& context,
-           senjo::SearchStats& searchStats, Line& pvLine);
+int search(ThreadData& thread, int alpha, int beta, int16_t depth, SearchContext& context);
 
 template <PieceColor color, NodeType nodeType>
-int qsearch(Bitboard& board, int alpha, int beta, int16_t depth,
-            SearchContext& context,
-            senjo::SearchStats& searchStats);
+int qsearch(ThreadData& thread, int alpha, int beta, int16_t depth, SearchContext& context);
 
 void printPv(senjo::SearchStats& searchStats, std::chrono::steady_clock::time_point& startTime,
              Line& pvLine);
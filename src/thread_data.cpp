@@ -0,0 +1,55 @@
+/*
+ This file is part of Zagreus.
+
+ Zagreus is a UCI chess engine
+ Copyright (C) 2023-2024  Danny Jelsma
+
+ Zagreus is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published
+ by the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Zagreus is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with Zagreus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "thread_data.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Zagreus {
+void ThreadData::ageHistoryTable() {
+    for (int i = 0; i < PIECE_TYPES; i++) {
+        for (int j = 0; j < SQUARES; j++) {
+            historyMoves[i][j] /= 8;
+        }
+    }
+}
+
+bool ThreadData::copyPv(int ply, Line& line) const {
+    if (pvLength[ply] <= ply) {
+        return false;
+    }
+
+    line.startPly = ply;
+    line.moveCount = std::min(pvLength[ply] - ply, static_cast<int>(MAX_MOVES));
+    std::memcpy(line.moves, &pvTable[ply][ply], line.moveCount * sizeof(Move));
+    return true;
+}
+
+void ThreadData::reset() {
+    std::memset(killerMoves, 0, sizeof(killerMoves));
+    std::memset(historyMoves, 0, sizeof(historyMoves));
+    std::memset(counterMoves, 0, sizeof(counterMoves));
+    searchStats = {};
+    publishedNodes.store(0, std::memory_order_relaxed);
+    evalCacheHits = 0;
+    evalCacheMisses = 0;
+}
+} // namespace Zagreus
@@ -0,0 +1,99 @@
+/*
+ This file is part of Zagreus.
+
+ Zagreus is a UCI chess engine
+ Copyright (C) 2023-2024  Danny Jelsma
+
+ Zagreus is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published
+ by the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Zagreus is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with Zagreus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "../senjo/SearchStats.h"
+#include "bitboard.h"
+#include "evaluate.h"
+#include "types.h"
+
+namespace Zagreus {
+// Everything a single search thread writes to during the search. Every thread gets its own copy, so
+// only the transposition table is shared between threads (Lazy SMP).
+struct ThreadData {
+    int threadId = 0;
+    Bitboard board{};
+    senjo::SearchStats searchStats{};
+    // Snapshot of the node count for other threads. The counters in searchStats are only written by
+    // the thread itself, and reading them while it searches would be a data race.
+    std::atomic<uint64_t> publishedNodes{0};
+    PawnHashTable pawnTable{};
+    // One move list per ply, so a node can take the list of its own ply without any allocation. The
+    // lists of the plies above it are still in use by its parents.
+    MoveList moveLists[MAX_PLY]{};
+
+    // Triangular PV table. The row of a ply holds the PV of the node at that ply, from the ply itself
+    // up to pvLength[ply], so a node builds its PV from the row of its child.
+    Move pvTable[MAX_PLY + 1][MAX_PLY]{};
+    int pvLength[MAX_PLY + 1]{};
+
+    Move killerMoves[3][MAX_PLY]{};
+    uint32_t historyMoves[PIECE_TYPES][SQUARES]{};
+    Move counterMoves[PIECE_TYPES][SQUARES]{};
+
+    // Reading the clock costs more than a node, so the time and the stop flag are only checked
+    // every STOP_CHECK_INTERVAL nodes. Once the thread saw that it has to stop, searchStopped is
+    // set, which is checked at every node.
+    int nodesUntilStopCheck = STOP_CHECK_INTERVAL;
+    bool searchStopped = false;
+
+    uint64_t evalCacheHits = 0;
+    uint64_t evalCacheMisses = 0;
+
+    bool isMainThread() const { return threadId == 0; }
+
+    void publishNodes() {
+        publishedNodes.store(searchStats.nodes + searchStats.qnodes, std::memory_order_relaxed);
+    }
+
+    MoveList* getMoveList(int ply) {
+        MoveList* moveList = &moveLists[ply];
+        moveList->size = 0;
+        return moveList;
+    }
+
+    void clearPv(int ply) { pvLength[ply] = ply; }
+
+    // Sets the PV of the node at the given ply to the move, followed by the PV of its child
+    void updatePv(int ply, Move move) {
+        int childLength = pvLength[ply + 1];
+
+        pvTable[ply][ply] = move;
+
+        for (int i = ply + 1; i < childLength; i++) {
+            pvTable[ply][i] = pvTable[ply + 1][i];
+        }
+
+        pvLength[ply] = childLength;
+    }
+
+    // Copies the PV of the node at the given ply into the line. Returns false if the node has no PV,
+    // because none of its moves raised alpha.
+    bool copyPv(int ply, Line& line) const;
+
+    void ageHistoryTable();
+
+    void reset();
+};
+} // namespace Zagreus
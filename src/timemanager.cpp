@@ -28,18 +28,45 @@
 #include "types.h"
 
 namespace Zagreus {
-std::chrono::time_point<std::chrono::steady_clock> getEndTime(SearchContext& context,
-                                                              senjo::GoParams& params,
-                                                              ZagreusEngine& engine,
-                                                              PieceColor movingColor) {
-    if (params.infinite || params.depth > 0 || params.nodes > 0) {
-        return std::chrono::time_point<std::chrono::steady_clock>::max();
+// The hard limit is this many times the base time per move, so an iteration that is still running at
+// the soft limit gets room to finish
+static constexpr int HARD_LIMIT_FACTOR = 4;
+
+// A best move that stayed the same for several iterations is unlikely to change, so less time is
+// needed. Indexed by the number of iterations the best move has been stable, up to 4.
+static constexpr double STABILITY_FACTORS[5] = {1.4, 1.2, 1.0, 0.85, 0.75};
+
+void updateTimeLimits(SearchContext& context, senjo::GoParams& params, ZagreusEngine& engine,
+                      PieceColor movingColor) {
+    using std::chrono::milliseconds;
+
+    // The clock of the engine only starts running at the ponderhit, so the time spent pondering is
+    // not taken from the budget
+    if (context.pondering) {
+        if (engine.isPondering()) {
+            context.softEndTime = std::chrono::time_point<std::chrono::steady_clock>::max();
+            context.endTime = std::chrono::time_point<std::chrono::steady_clock>::max();
+            return;
+        }
+
+        context.pondering = false;
+        context.startTime = std::chrono::steady_clock::now();
     }
 
+    if (params.infinite || params.depth > 0 || params.nodes > 0 || params.mate > 0) {
+        context.softEndTime = std::chrono::time_point<std::chrono::steady_clock>::max();
+        context.endTime = std::chrono::time_point<std::chrono::steady_clock>::max();
+        return;
+    }
+
+    uint64_t moveOverhead = engine.getOption("MoveOverhead").getIntValue();
+
     if (params.movetime > 0) {
-        return context.startTime +
-               std::chrono::milliseconds(params.movetime -
-                                         engine.getOption("MoveOverhead").getIntValue());
+        uint64_t moveTime = std::max(params.movetime, moveOverhead + 1) - moveOverhead;
+
+        context.softEndTime = context.startTime + milliseconds(moveTime);
+        context.endTime = context.softEndTime;
+        return;
     }
 
     int movesToGo = params.movestogo ? params.movestogo : 50ULL;
@@ -54,10 +81,14 @@ std::chrono::time_point<std::chrono::steady_clock> getEndTime(SearchContext& con
         timeLeft += params.binc * movesToGo;
     }
 
-    uint64_t moveOverhead = engine.getOption("MoveOverhead").getIntValue();
-    timeLeft -= moveOverhead * movesToGo;
+    // On a short clock the overhead of all the remaining moves is more than the clock itself, and
+    // timeLeft is unsigned. At least half of the clock is kept, so there is always some time to
+    // search.
+    uint64_t clockTime = movingColor == WHITE ? params.wtime : params.btime;
+    uint64_t totalOverhead = moveOverhead * movesToGo;
 
-    timeLeft = std::max((uint64_t)timeLeft, (uint64_t)1ULL);
+    timeLeft = timeLeft > totalOverhead ? timeLeft - totalOverhead : 0;
+    timeLeft = std::max({timeLeft, clockTime / 2, (uint64_t)1ULL});
     uint64_t maxTime;
 
     if (movingColor == WHITE) {
@@ -75,29 +106,56 @@ std::chrono::time_point<std::chrono::steady_clock> getEndTime(SearchContext& con
     }
 
     uint64_t timePerMove = timeLeft / movesToGo;
+    double softTime = static_cast<double>(timePerMove);
+
+    softTime *= STABILITY_FACTORS[std::min(context.bestMoveStability, 4)];
 
-    // Based on context.pvChanges, scale timePerMove between 1.0 and 1.5. After 5 or more move
-    // changes, timePerMove will be 1.5 times as long.
-    if (context.pvChanges > 0) {
-        timePerMove =
-            timePerMove * (1.0 + std::min(static_cast<double>(context.pvChanges), 5.0) / 10.0);
+    // Spend more time when the search had to look at the other root moves a lot, as that means the
+    // best move is not clearly better. Scales between 0.5 and 1.5.
+    if (context.iterationNodes > 0) {
+        double bestMoveFraction = static_cast<double>(context.bestMoveNodes)
+                                  / static_cast<double>(context.iterationNodes);
+
+        softTime *= 1.5 - std::min(bestMoveFraction, 1.0);
     }
 
     // if the score suddenly went from positive to negative or vice versa, increase timePerMove by 50%
     if (context.suddenScoreSwing) {
-        timePerMove = timePerMove * 1.5;
+        softTime *= 1.5;
     }
 
     // if the score suddenly dropped by 100cp or more, increase timePerMove by 50%
     if (context.suddenScoreDrop) {
-        timePerMove = timePerMove * 1.5;
+        softTime *= 1.5;
+    }
+
+    uint64_t hardTime = std::min(timePerMove * HARD_LIMIT_FACTOR, maxTime);
+    hardTime = std::max(hardTime, (uint64_t)1ULL);
+    softTime = std::min(softTime, static_cast<double>(hardTime));
+
+    context.softEndTime = context.startTime + milliseconds(static_cast<uint64_t>(softTime));
+    context.endTime = context.startTime + milliseconds(hardTime);
+}
+
+bool canStartIteration(SearchContext& context) {
+    auto currentTime = std::chrono::steady_clock::now();
+
+    if (currentTime > context.softEndTime) {
+        return false;
     }
 
-    if (timePerMove > maxTime) {
-        timePerMove = maxTime;
+    if (context.previousIterationNodes == 0) {
+        return true;
     }
 
-    timePerMove = std::max((uint64_t)timePerMove, (uint64_t)1ULL);
-    return context.startTime + std::chrono::milliseconds(timePerMove);
+    // Every iteration takes about the effective branching factor times as long as the one before.
+    // An iteration that is expected to run past the hard limit would be aborted anyway.
+    double branchingFactor = static_cast<double>(context.iterationNodes)
+                             / static_cast<double>(context.previousIterationNodes);
+    branchingFactor = std::clamp(branchingFactor, 1.0, 10.0);
+    auto predictedTime = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        context.iterationTime * branchingFactor);
+
+    return currentTime + predictedTime <= context.endTime;
 }
-} // namespace Zagreus
\ No newline at end of file
+} // namespace Zagreus
@@ -26,8 +26,11 @@
 #include "types.h"
 
 namespace Zagreus {
-std::chrono::time_point<std::chrono::steady_clock> getEndTime(SearchContext& context,
-                                                              senjo::GoParams& params,
-                                                              ZagreusEngine& engine,
-                                                              PieceColor movingColor);
-} // namespace Zagreus
\ No newline at end of file
+// Sets the soft and the hard time limit of the search. No new iteration is started after the soft
+// limit, the search is aborted at the hard limit.
+void updateTimeLimits(SearchContext& context, senjo::GoParams& params, ZagreusEngine& engine,
+                      PieceColor movingColor);
+
+// Checks if there is enough time left to start the next iteration and finish it
+bool canStartIteration(SearchContext& context);
+} // namespace Zagreus
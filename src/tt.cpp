@@ -20,18 +20,43 @@
 
 #include "tt.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstdlib>
 #include <iostream>
+#include <new>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
 
 #include "search.h"
 
 namespace Zagreus {
+static uint64_t packEntry(const TTEntry& entry) {
+    return static_cast<uint64_t>(entry.bestMove)
+           | static_cast<uint64_t>(static_cast<uint16_t>(entry.score)) << 16
+           | static_cast<uint64_t>(static_cast<uint8_t>(entry.depth - INT8_MIN)) << 32
+           | static_cast<uint64_t>(entry.nodeType) << 40
+           | static_cast<uint64_t>(entry.generation) << 42;
+}
+
+static TTEntry unpackEntry(uint64_t data) {
+    TTEntry entry{};
+
+    entry.bestMove = static_cast<Move>(data);
+    entry.score = static_cast<int16_t>(data >> 16);
+    entry.depth = static_cast<int8_t>(static_cast<int>((data >> 32) & 0xFF) + INT8_MIN);
+    entry.nodeType = static_cast<TTNodeType>((data >> 40) & 0x3);
+    entry.generation = static_cast<uint8_t>((data >> 42) & 0x3F);
+    return entry;
+}
+
 void TranspositionTable::addPosition(uint64_t zobristHash, int16_t depth, int score,
-                                     TTNodeType nodeType, uint32_t bestMoveCode, int ply,
-                                     SearchContext& context) {
-    // current time
-    auto currentTime = std::chrono::steady_clock::now();
-    if (score > MAX_POSITIVE || score < MAX_NEGATIVE || currentTime > context.endTime) {
+                                     TTNodeType nodeType, Move bestMove, int ply) {
+    if (score > MAX_POSITIVE || score < MAX_NEGATIVE) {
         return;
     }
 
@@ -39,24 +64,56 @@ void TranspositionTable::addPosition(uint64_t zobristHash, int16_t depth, int sc
         return;
     }
 
-    uint64_t index = zobristHash & hashSize;
-    TTEntry* entry = &transpositionTable[index];
+    int adjustedScore = score;
+
+    if (adjustedScore >= (MATE_SCORE - MAX_PLY)) {
+        adjustedScore += ply;
+    } else if (adjustedScore <= (-MATE_SCORE + MAX_PLY)) {
+        adjustedScore -= ply;
+    }
+
+    if (adjustedScore < INT16_MIN || adjustedScore > INT16_MAX) {
+        return;
+    }
+
+    TTBucket* bucket = &transpositionTable[zobristHash & hashSize];
+    TTSlot* replaceSlot = nullptr;
+    int lowestReplaceScore = INT32_MAX;
+
+    // Prefer the slot that already holds this position. Otherwise, replace the entry with the
+    // lowest depth, where every search that passed since the entry was stored costs 8 plies.
+    for (TTSlot& slot : bucket->slots) {
+        uint64_t data = slot.data.load(std::memory_order_relaxed);
+        TTEntry entry = unpackEntry(data);
 
-    if (depth > entry->depth) {
-        int adjustedScore = score;
+        if ((slot.key.load(std::memory_order_relaxed) ^ data) == zobristHash) {
+            if (depth <= entry.depth && entry.generation == generation) {
+                return;
+            }
 
-        if (adjustedScore >= (MATE_SCORE - MAX_PLY)) {
-            adjustedScore += ply;
-        } else if (adjustedScore <= (-MATE_SCORE + MAX_PLY)) {
-            adjustedScore -= ply;
+            replaceSlot = &slot;
+            break;
         }
 
-        entry->validationHash = zobristHash >> 32;
-        entry->depth = static_cast<int8_t>(depth);
-        entry->bestMoveCode = bestMoveCode;
-        entry->score = adjustedScore;
-        entry->nodeType = nodeType;
+        int age = (TT_GENERATION_CYCLE + generation - entry.generation) % TT_GENERATION_CYCLE;
+        int replaceScore = entry.depth - 8 * age;
+
+        if (replaceScore < lowestReplaceScore) {
+            replaceSlot = &slot;
+            lowestReplaceScore = replaceScore;
+        }
     }
+
+    TTEntry newEntry{};
+    newEntry.bestMove = bestMove;
+    newEntry.score = static_cast<int16_t>(adjustedScore);
+    newEntry.depth = static_cast<int8_t>(depth);
+    newEntry.nodeType = nodeType;
+    newEntry.generation = generation;
+
+    uint64_t data = packEntry(newEntry);
+    replaceSlot->key.store(zobristHash ^ data, std::memory_order_relaxed);
+    replaceSlot->data.store(data, std::memory_order_relaxed);
 }
 
 int TranspositionTable::getScore(uint64_t zobristHash, int16_t depth, int alpha, int beta,
@@ -65,31 +122,30 @@ int TranspositionTable::getScore(uint64_t zobristHash, int16_t depth, int alpha,
         return INT32_MIN;
     }
 
-    uint64_t index = zobristHash & hashSize;
-    uint32_t validationHash = zobristHash >> 32;
-    TTEntry* entry = &transpositionTable[index];
+    TTEntry entry{};
 
-    if (entry->validationHash == validationHash && entry->depth >= depth) {
+    if (getEntry(zobristHash, entry) && entry.depth >= depth) {
         bool returnScore = false;
 
-        if (entry->nodeType == EXACT_NODE) {
+        if (entry.nodeType == EXACT_NODE) {
             returnScore = true;
-        } else if (entry->nodeType == FAIL_LOW_NODE) {
-            if (entry->score <= alpha) {
+        } else if (entry.nodeType == FAIL_LOW_NODE) {
+            if (entry.score <= alpha) {
                 returnScore = true;
             }
-        } else if (entry->nodeType == FAIL_HIGH_NODE) {
-            if (entry->score >= beta) {
+        } else if (entry.nodeType == FAIL_HIGH_NODE) {
+            if (entry.score >= beta) {
                 returnScore = true;
             }
         }
 
         if (returnScore) {
-            int adjustedScore = entry->score;
+            int adjustedScore = entry.score;
 
-            if (adjustedScore >= MATE_SCORE) {
+            // Undo the adjustment of addPosition, so the mate distance is counted from this ply
+            if (adjustedScore >= (MATE_SCORE - MAX_PLY)) {
                 adjustedScore -= ply;
-            } else if (adjustedScore <= -MATE_SCORE) {
+            } else if (adjustedScore <= (-MATE_SCORE + MAX_PLY)) {
                 adjustedScore += ply;
             }
 
@@ -100,69 +156,132 @@ int TranspositionTable::getScore(uint64_t zobristHash, int16_t depth, int alpha,
     return INT32_MIN;
 }
 
-TTEntry* TranspositionTable::getEntry(uint64_t zobristHash) {
-    uint64_t index = zobristHash & hashSize;
+bool TranspositionTable::getEntry(uint64_t zobristHash, TTEntry& entry) {
+    TTBucket* bucket = &transpositionTable[zobristHash & hashSize];
+
+    for (TTSlot& slot : bucket->slots) {
+        uint64_t data = slot.data.load(std::memory_order_relaxed);
 
-    return &transpositionTable[index];
+        if ((slot.key.load(std::memory_order_relaxed) ^ data) == zobristHash) {
+            entry = unpackEntry(data);
+            return true;
+        }
+    }
+
+    return false;
 }
 
-void TranspositionTable::setTableSize(int megaBytes) {
+void TranspositionTable::setTableSize(int megaBytes, int threadCount) {
     if ((megaBytes & (megaBytes - 1)) != 0) {
         megaBytes = 1 << static_cast<int>(log2(megaBytes));
     }
 
-    uint64_t byteSize = megaBytes * 1024 * 1024;
-    uint64_t entryCount = byteSize / sizeof(TTEntry);
+    uint64_t byteSize = static_cast<uint64_t>(megaBytes) * 1024 * 1024;
+
+    freeTable();
+    allocateTable(byteSize / sizeof(TTBucket), threadCount);
+}
+
+// Constructs (and thereby zeroes) the buckets in parallel. Besides being a lot faster for big
+// tables, this makes sure that every thread touches its part of the table first, so on NUMA
+// machines the pages get spread over the memory of all nodes instead of just one.
+static void clearBuckets(TTBucket* buckets, uint64_t bucketCount, int threadCount) {
+    threadCount = std::max(1, threadCount);
+    uint64_t bucketsPerThread = bucketCount / threadCount;
+    std::vector<std::thread> threads{};
+
+    auto clearRange = [buckets](uint64_t start, uint64_t end) {
+        for (uint64_t i = start; i < end; i++) {
+            new (&buckets[i]) TTBucket{};
+        }
+    };
 
-    delete[] transpositionTable;
-    transpositionTable = new TTEntry[entryCount]{};
-    hashSize = entryCount - 1;
+    for (int t = 1; t < threadCount; t++) {
+        uint64_t start = t * bucketsPerThread;
+        uint64_t end = t == threadCount - 1 ? bucketCount : start + bucketsPerThread;
 
-    for (uint64_t i = 0; i < entryCount; i++) {
-        transpositionTable[i] = {};
+        threads.emplace_back(clearRange, start, end);
     }
-}
 
-TranspositionTable* TranspositionTable::getTT() {
-    static TranspositionTable instance{};
-    return &instance;
-}
+    clearRange(0, threadCount == 1 ? bucketCount : bucketsPerThread);
 
-void TranspositionTable::ageHistoryTable() {
-    for (int i = 0; i < PIECE_TYPES; i++) {
-        for (int j = 0; j < SQUARES; j++) {
-            historyMoves[i][j] /= 8;
-        }
+    for (std::thread& thread : threads) {
+        thread.join();
     }
 }
 
-void TranspositionTable::reset() {
-    for (int i = 0; i < 3; i++) {
-        delete[] killerMoves[i];
+void TranspositionTable::allocateTable(uint64_t bucketCount, int threadCount) {
+    constexpr uint64_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+    uint64_t byteSize = bucketCount * sizeof(TTBucket);
+    // Align big tables to the huge page size, so they can be backed by 2 MB pages which saves a lot
+    // of TLB misses. The size has to be a multiple of the alignment, which is always the case here
+    // as the table size is a power of two.
+    uint64_t alignment = byteSize >= HUGE_PAGE_SIZE ? HUGE_PAGE_SIZE : alignof(TTBucket);
+
+#if defined(_WIN32)
+    void* memory = _aligned_malloc(byteSize, alignment);
+#else
+    void* memory = std::aligned_alloc(alignment, byteSize);
+#endif
+
+    if (memory == nullptr) {
+        throw std::bad_alloc();
     }
 
-    for (int i = 0; i < 12; i++) {
-        delete[] historyMoves[i];
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    // Only a hint, when transparent huge pages are disabled we just get regular pages
+    if (alignment == HUGE_PAGE_SIZE) {
+        madvise(memory, byteSize, MADV_HUGEPAGE);
     }
+#endif
 
-    for (int i = 0; i < PIECE_TYPES; i++) {
-        delete[] counterMoves[i];
-    }
+    transpositionTable = static_cast<TTBucket*>(memory);
+    hashSize = bucketCount - 1;
+    clearBuckets(transpositionTable, bucketCount, threadCount);
+}
 
-    for (uint64_t i = 0; i < hashSize; i++) {
-        transpositionTable[i] = {};
-    }
+void TranspositionTable::freeTable() {
+#if defined(_WIN32)
+    _aligned_free(transpositionTable);
+#else
+    std::free(transpositionTable);
+#endif
 
-    for (int i = 0; i < 3; i++) {
-        killerMoves[i] = new uint32_t[MAX_PLY]{};
-    }
+    transpositionTable = nullptr;
+    hashSize = 0;
+}
 
-    for (int i = 0; i < PIECE_TYPES; i++) {
-        historyMoves[i] = new uint32_t[64]{};
-    }
+void TranspositionTable::incrementGeneration() {
+    generation = (generation + 1) % TT_GENERATION_CYCLE;
+}
 
-    for (int i = 0; i < PIECE_TYPES; i++) {
-        counterMoves[i] = new uint32_t[64]{};
+// Estimates the permill of the table that is used by the current search, based on the first 1000
+// slots
+int TranspositionTable::getHashfull() {
+    constexpr uint64_t SAMPLED_BUCKETS = 1000 / TT_BUCKET_SIZE;
+    uint64_t bucketCount = std::min(SAMPLED_BUCKETS, hashSize + 1);
+    int usedSlots = 0;
+
+    for (uint64_t i = 0; i < bucketCount; i++) {
+        for (TTSlot& slot : transpositionTable[i].slots) {
+            uint64_t data = slot.data.load(std::memory_order_relaxed);
+
+            if (data != 0 && unpackEntry(data).generation == generation) {
+                usedSlots += 1;
+            }
+        }
     }
+
+    return static_cast<int>(usedSlots * 1000 / (bucketCount * TT_BUCKET_SIZE));
+}
+
+TranspositionTable* TranspositionTable::getTT() {
+    static TranspositionTable instance{};
+    return &instance;
+}
+
+void TranspositionTable::reset(int threadCount) {
+    generation = 0;
+    clearBuckets(transpositionTable, hashSize + 1, threadCount);
 }
 } // namespace Zagreus
\ No newline at end of file
@@ -20,10 +20,9 @@
 
 #pragma once
 
-#include <chrono>
+#include <atomic>
 #include <cstdint>
 
-#include "search.h"
 #include "types.h"
 
 namespace Zagreus {
@@ -33,56 +32,47 @@ enum TTNodeType : uint8_t {
     FAIL_HIGH_NODE // Beta score
 };
 
+// The unpacked contents of a TT slot. Packed into a single 64-bit word when stored.
 struct TTEntry {
-    int score = 0;
-    uint32_t bestMoveCode = 0;
-    uint32_t validationHash = 0;
+    Move bestMove = NO_MOVE;
+    int16_t score = 0;
     int8_t depth = INT8_MIN;
     TTNodeType nodeType = EXACT_NODE;
+    uint8_t generation = 0;
 };
 
-class TranspositionTable {
-public:
-    TTEntry* transpositionTable = new TTEntry[1]{};
-    uint32_t** killerMoves = new uint32_t*[3]{};
-    uint32_t** historyMoves = new uint32_t*[PIECE_TYPES]{};
-    uint32_t** counterMoves = new uint32_t*[PIECE_TYPES]{};
+// The key is stored XOR'ed with the data, so a slot that was torn by two threads writing to it at
+// the same time will simply fail validation instead of returning data of another position.
+struct TTSlot {
+    std::atomic<uint64_t> key{0};
+    std::atomic<uint64_t> data{0};
+};
 
-    uint64_t hashSize = 0;
+static constexpr int TT_BUCKET_SIZE = 4;
+// The generation is stored in 6 bits, so it wraps around after 64 searches
+static constexpr int TT_GENERATION_CYCLE = 64;
 
-    TranspositionTable() {
-        for (int i = 0; i < 3; i++) {
-            killerMoves[i] = new uint32_t[MAX_PLY]{};
-        }
+struct alignas(64) TTBucket {
+    TTSlot slots[TT_BUCKET_SIZE];
+};
 
-        for (int i = 0; i < PIECE_TYPES; i++) {
-            historyMoves[i] = new uint32_t[64]{};
-        }
+static_assert(sizeof(TTBucket) == 64, "A TT bucket must fit exactly in one cache line");
 
-        for (int i = 0; i < PIECE_TYPES; i++) {
-            counterMoves[i] = new uint32_t[64]{};
-        }
-    }
+class TranspositionTable {
+private:
+    void allocateTable(uint64_t bucketCount, int threadCount);
 
-    ~TranspositionTable() {
-        delete[] transpositionTable;
+    void freeTable();
 
-        for (int i = 0; i < 3; i++) {
-            delete[] killerMoves[i];
-        }
+public:
+    TTBucket* transpositionTable = nullptr;
 
-        for (int i = 0; i < 12; i++) {
-            delete[] historyMoves[i];
-        }
+    uint64_t hashSize = 0;
+    uint8_t generation = 0;
 
-        for (int i = 0; i < PIECE_TYPES; i++) {
-            delete[] counterMoves[i];
-        }
+    TranspositionTable() { allocateTable(1, 1); }
 
-        delete[] killerMoves;
-        delete[] historyMoves;
-        delete[] counterMoves;
-    }
+    ~TranspositionTable() { freeTable(); }
 
     TranspositionTable(TranspositionTable& other) = delete;
 
@@ -90,17 +80,23 @@ public:
 
     static TranspositionTable* getTT();
 
-    void setTableSize(int megaBytes);
+    void setTableSize(int megaBytes, int threadCount);
 
     void addPosition(uint64_t zobristHash, int16_t depth, int score, TTNodeType nodeType,
-                     uint32_t bestMoveCode, int ply, SearchContext& context);
+                     Move bestMove, int ply);
 
     int getScore(uint64_t zobristHash, int16_t depth, int alpha, int beta, int ply);
 
-    TTEntry* getEntry(uint64_t zobristHash);
+    bool getEntry(uint64_t zobristHash, TTEntry& entry);
+
+    void prefetch(uint64_t zobristHash) {
+        __builtin_prefetch(&transpositionTable[zobristHash & hashSize]);
+    }
+
+    void incrementGeneration();
 
-    void ageHistoryTable();
+    int getHashfull();
 
-    void reset();
+    void reset(int threadCount);
 };
 } // namespace Zagreus
\ No newline at end of file
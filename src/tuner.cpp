@@ -39,7 +39,6 @@ float K = 0.0;
 
 int batchSize = 256;
 float learningRate = 0.1;
-float delta = 1.0;
 float optimizerEpsilon = 1e-6;
 float beta1 = 0.9;
 float beta2 = 0.999;
@@ -123,6 +122,50 @@ float findOptimalK(std::vector<TunePosition>& positions) {
     return (a + b) / 2.0f;
 }
 
+// The eval features alternate between midgame and endgame values, the piece square tables are split
+// in a midgame and an endgame half
+bool isEndgameParameter(int paramIndex) {
+    if (paramIndex < EVAL_FEATURE_COUNT) {
+        return paramIndex % 2 == 1;
+    }
+
+    return paramIndex >= EVAL_FEATURE_COUNT + PST_PARAMETER_COUNT;
+}
+
+// Adds the gradient of the loss of the batch to gradients. As the evaluation is linear in its
+// parameters (apart from rounding), the trace gives the derivative of the evaluation directly.
+void addBatchGradients(std::vector<TunePosition>& batch, std::vector<float>& gradients) {
+    for (TunePosition& pos : batch) {
+        tunerBoard.setFromFenTuner(pos.fen);
+        Evaluation<EvalTrace> evaluation(tunerBoard);
+        int evalScore = evaluation.evaluate();
+
+        // All scores are from white's perspective
+        if (tunerBoard.getMovingColor() == BLACK) {
+            evalScore *= -1;
+        }
+
+        float sigmoidScore = sigmoid(evalScore);
+        float sigmoidGradient =
+            sigmoidScore * (1.0f - sigmoidScore) * K * std::log(10.0f) / 400.0f;
+        float lossGradient = -2.0f * (pos.result - sigmoidScore) * sigmoidGradient /
+                             static_cast<float>(batch.size());
+        const EvalTrace& trace = evaluation.getTrace();
+
+        for (int paramIndex = 0; paramIndex < TRACE_SIZE; paramIndex++) {
+            int coefficient =
+                trace.coefficients[WHITE][paramIndex] - trace.coefficients[BLACK][paramIndex];
+
+            if (coefficient == 0) {
+                continue;
+            }
+
+            int phaseWeight = isEndgameParameter(paramIndex) ? trace.phase : 256 - trace.phase;
+            gradients[paramIndex] += lossGradient * coefficient * phaseWeight / 256.0f;
+        }
+    }
+}
+
 std::vector<TunePosition> loadPositions(
     char* filePath, std::chrono::time_point<std::chrono::steady_clock>& maxEndTime,
     std::mt19937_64 gen) {
@@ -150,7 +193,7 @@ std::vector<TunePosition> loadPositions(
         std::string resultStr = posLine.substr(posLine.find(" c9 ") + 4, posLine.find(" c9 ") + 4);
         std::string fen = posLine.substr(0, posLine.find(" c9 "));
 
-        if (!tunerBoard.setFromFen(fen) || tunerBoard.isDraw() || tunerBoard.isWinner<WHITE>()
+        if (!tunerBoard.setFromFen(fen) || tunerBoard.isDraw(tunerBoard.getPly()) || tunerBoard.isWinner<WHITE>()
             || tunerBoard.isWinner<BLACK>()) {
             continue;
         }
@@ -348,32 +391,8 @@ void startTuning(char* filePath) {
                 totalIterations << " (" << percentDone << "%)" << std::endl;
             std::ranges::fill(gradients, 0.0f);
 
-            for (int paramIndex = 0; paramIndex < bestParameters.size(); paramIndex++) {
-                float oldParam = bestParameters[paramIndex];
-
-                bestParameters[paramIndex] = oldParam + delta;
-                updateEvalValues(bestParameters);
-                float fPlusDelta = evaluationLoss(batch);
-
-                bestParameters[paramIndex] = oldParam - delta;
-                updateEvalValues(bestParameters);
-                float fMinusDelta = evaluationLoss(batch);
-
-                bestParameters[paramIndex] = oldParam + 2 * delta;
-                updateEvalValues(bestParameters);
-                float fPlus2Delta = evaluationLoss(batch);
-
-                bestParameters[paramIndex] = oldParam - 2 * delta;
-                updateEvalValues(bestParameters);
-                float fMinus2Delta = evaluationLoss(batch);
-
-                gradients[paramIndex] += (
-                    -fPlus2Delta + 8.0f * fPlusDelta - 8.0f * fMinusDelta + fMinus2Delta) / (
-                    12.0f * delta);
-
-                // reset
-                bestParameters[paramIndex] = oldParam;
-            }
+            updateEvalValues(bestParameters);
+            addBatchGradients(batch, gradients);
 
             for (int paramIndex = 0; paramIndex < bestParameters.size(); paramIndex++) {
                 m[paramIndex] = beta1 * m[paramIndex] + (1.0f - beta1) * gradients[paramIndex];
@@ -119,29 +119,30 @@ enum Square {
 
 // clang-format on
 
-struct Move {
-    int8_t from = 0;
-    int8_t to = 0;
-    PieceType piece = EMPTY;
-    int captureScore = NO_CAPTURE_SCORE;
-    PieceType promotionPiece = EMPTY;
-    int score = 0;
-};
+// A move packed into 16 bits: the from square in bits 0-5, the to square in bits 6-11 and the
+// promotion piece type in bits 12-14 (1 = knight up to 4 = queen, 0 when the move is not a
+// promotion). The moving and captured pieces are looked up on the board.
+using Move = uint16_t;
+
+static constexpr Move NO_MOVE = 0;
 
 enum MoveType { REGULAR, EN_PASSANT, CASTLING };
 
 struct UndoData {
     uint8_t halfMoveClock = 0;
+    uint16_t pliesFromNull = 0;
     int8_t enPassantSquare = NO_SQUARE;
     uint8_t castlingRights = 0;
     PieceType capturedPiece = EMPTY;
     MoveType moveType = REGULAR;
     uint64_t zobristHash = 0ULL;
-    Move previousMove{};
+    Move previousMove = NO_MOVE;
 };
 
+// The scores are only filled in by the MovePicker, to order the moves
 struct MoveList {
     Move moves[MAX_MOVES]{};
+    int scores[MAX_MOVES]{};
     uint8_t size = 0;
 };
 
@@ -159,27 +160,4 @@ struct Line {
     int startPly = 0;
     Move moves[MAX_MOVES]{};
 };
-
-struct EvalContext {
-    int phase = 0;
-    int whiteMidgameScore = 0;
-    int blackMidgameScore = 0;
-    int whiteEndgameScore = 0;
-    int blackEndgameScore = 0;
-    uint64_t whitePawnAttacks = 0;
-    uint64_t whiteKnightAttacks = 0;
-    uint64_t whiteBishopAttacks = 0;
-    uint64_t whiteRookAttacks = 0;
-    uint64_t whiteQueenAttacks = 0;
-    uint64_t whiteKingAttacks = 0;
-    uint64_t whiteCombinedAttacks = 0;
-    uint64_t blackPawnAttacks = 0;
-    uint64_t blackKnightAttacks = 0;
-    uint64_t blackBishopAttacks = 0;
-    uint64_t blackRookAttacks = 0;
-    uint64_t blackQueenAttacks = 0;
-    uint64_t blackKingAttacks = 0;
-    uint64_t blackCombinedAttacks = 0;
-    uint64_t attacksFrom[64] = {0ULL};
-};
 } // namespace Zagreus
\ No newline at end of file
@@ -32,6 +32,17 @@ std::string getNotation(int8_t square) {
     return notation;
 }
 
+std::string getMoveNotation(Move move) {
+    static constexpr char PROMOTION_CHARACTERS[] = {' ', 'n', 'b', 'r', 'q'};
+    std::string notation = getNotation(getFromSquare(move)) + getNotation(getToSquare(move));
+
+    if (isPromotion(move)) {
+        notation += PROMOTION_CHARACTERS[move >> 12];
+    }
+
+    return notation;
+}
+
 int8_t getSquareFromString(std::string move) {
     int file = move[0] - 'a';
     int rank = move[1] - '1';
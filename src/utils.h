@@ -45,11 +45,24 @@ inline int8_t popLsb(uint64_t& b) {
     return lsb;
 }
 
-inline uint32_t encodeMove(Move* move) {
-    return static_cast<uint32_t>(move->promotionPiece << 24)
-            | static_cast<uint32_t>(move->piece << 16)
-            | static_cast<uint32_t>(move->to << 8)
-            | static_cast<uint32_t>(move->from);
+inline Move encodeMove(int8_t from, int8_t to, PieceType promotionPiece = EMPTY) {
+    // The piece types of both colors are numbered pawn = 0 up to king = 5 when divided by 2
+    int promotionType = promotionPiece == EMPTY ? 0 : promotionPiece / 2;
+
+    return static_cast<Move>(from | to << 6 | promotionType << 12);
+}
+
+inline int8_t getFromSquare(Move move) { return static_cast<int8_t>(move & 0x3F); }
+
+inline int8_t getToSquare(Move move) { return static_cast<int8_t>((move >> 6) & 0x3F); }
+
+inline bool isPromotion(Move move) { return (move >> 12) != 0; }
+
+// Returns EMPTY if the move is not a promotion
+inline PieceType getPromotionPiece(Move move, PieceColor color) {
+    int promotionType = move >> 12;
+
+    return promotionType == 0 ? EMPTY : static_cast<PieceType>(promotionType * 2 + color);
 }
 
 inline uint16_t getPieceWeight(PieceType type) { return pieceWeights[type]; }
@@ -58,6 +71,9 @@ inline int mvvlva(PieceType attacker, PieceType victim) { return MVVLVA_TABLE[at
 
 std::string getNotation(int8_t square);
 
+// Returns the move in the UCI notation, like e2e4 or e7e8q
+std::string getMoveNotation(Move move);
+
 int8_t getSquareFromString(std::string move);
 
 char getCharacterForPieceType(PieceType pieceType);
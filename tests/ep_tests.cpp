@@ -29,11 +29,12 @@ TEST_CASE("Test en-passant", "[ep]") {
     Zagreus::Bitboard bb{};
 
     SECTION("6k1/p2q4/1p3pp1/2b4p/4p2P/P2P2P1/3Q1PK1/5B2 w - - 0 31") {
-        Zagreus::Move move{Zagreus::F2, Zagreus::F4, Zagreus::WHITE_PAWN};
+        bb.setFromFen("6k1/p2q4/1p3pp1/2b4p/4p2P/P2P2P1/3Q1PK1/5B2 w - - 0 31");
+        Zagreus::Move move = Zagreus::encodeMove(Zagreus::F2, Zagreus::F4);
         bb.makeMove(move);
         int8_t epSquare = bb.getEnPassantSquare();
         REQUIRE(epSquare == Zagreus::F3);
-        Zagreus::Move epMove{Zagreus::E4, Zagreus::F3, Zagreus::BLACK_PAWN};
+        Zagreus::Move epMove = Zagreus::encodeMove(Zagreus::E4, Zagreus::F3);
         bb.makeMove(epMove);
         Zagreus::PieceType pieceOnEpSquare = bb.getPieceOnSquare(Zagreus::F3);
         Zagreus::PieceType pieceOnCaptureSquare = bb.getPieceOnSquare(Zagreus::F4);
@@ -0,0 +1,120 @@
+/*
+ This file is part of Zagreus.
+
+ Zagreus is a UCI chess engine
+ Copyright (C) 2023-2024  Danny Jelsma
+
+ Zagreus is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published
+ by the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Zagreus is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with Zagreus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "catch2/catch_test_macros.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "../src/bitboard.h"
+#include "../src/engine.h"
+#include "../src/movegen.h"
+#include "../src/movepicker.h"
+#include "../src/thread_data.h"
+
+// Walks the tree and checks that the move picker returns exactly the generated moves in every
+// position. The PV, killer and counter moves of a ply are filled with the moves of the previously
+// visited node, so they are often not legal in the current position.
+template <Zagreus::PieceColor color>
+static void checkMovePicker(Zagreus::ThreadData& thread, int depth) {
+    constexpr Zagreus::PieceColor OPPOSITE_COLOR =
+        color == Zagreus::WHITE ? Zagreus::BLACK : Zagreus::WHITE;
+    Zagreus::Bitboard& board = thread.board;
+    bool inCheck = board.isKingInCheck<color>();
+    Zagreus::MoveList moveList{};
+    std::vector<Zagreus::Move> generatedMoves{};
+    std::vector<Zagreus::Move> pickedMoves{};
+
+    if (inCheck) {
+        Zagreus::generateMoves<color, Zagreus::EVASIONS>(board, &moveList);
+    } else {
+        Zagreus::generateMoves<color, Zagreus::NORMAL>(board, &moveList);
+    }
+
+    for (int i = 0; i < moveList.size; i++) {
+        generatedMoves.push_back(moveList.moves[i]);
+    }
+
+    {
+        Zagreus::MovePicker<color> movePicker(thread, inCheck ? Zagreus::EVASIONS
+                                                              : Zagreus::NORMAL);
+        Zagreus::Move move = Zagreus::NO_MOVE;
+
+        while (movePicker.getNextMove(move)) {
+            pickedMoves.push_back(move);
+        }
+    }
+
+    std::vector<Zagreus::Move> sortedPickedMoves = pickedMoves;
+    std::sort(generatedMoves.begin(), generatedMoves.end());
+    std::sort(sortedPickedMoves.begin(), sortedPickedMoves.end());
+    REQUIRE(generatedMoves == sortedPickedMoves);
+
+    if (depth <= 1) {
+        return;
+    }
+
+    int ply = board.getPly();
+
+    for (Zagreus::Move move : pickedMoves) {
+        board.makeMove(move);
+        REQUIRE(!board.isKingInCheck<color>());
+        checkMovePicker<OPPOSITE_COLOR>(thread, depth - 1);
+        board.unmakeMove(move);
+
+        Zagreus::PieceType piece = board.getPieceOnSquare(Zagreus::getFromSquare(move));
+        thread.killerMoves[2][ply] = thread.killerMoves[1][ply];
+        thread.killerMoves[1][ply] = thread.killerMoves[0][ply];
+        thread.killerMoves[0][ply] = move;
+        thread.counterMoves[piece][Zagreus::getToSquare(move)] = move;
+
+        Zagreus::Line pvLine = board.getPvLine();
+        pvLine.moves[ply] = move;
+        board.setPvLine(pvLine);
+    }
+}
+
+TEST_CASE("Test that the move picker returns every move exactly once", "[movepicker]") {
+    Zagreus::ZagreusEngine engine{};
+    std::unique_ptr<Zagreus::ThreadData> thread = std::make_unique<Zagreus::ThreadData>();
+    std::vector<std::string> positions = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - -",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    };
+
+    for (std::string& fen : positions) {
+        thread->reset();
+        thread->board.setFromFen(fen);
+
+        Zagreus::Line pvLine{};
+        pvLine.moveCount = 8;
+        thread->board.setPvLine(pvLine);
+
+        if (thread->board.getMovingColor() == Zagreus::WHITE) {
+            checkMovePicker<Zagreus::WHITE>(*thread, 3);
+        } else {
+            checkMovePicker<Zagreus::BLACK>(*thread, 3);
+        }
+    }
+}
@@ -0,0 +1,120 @@
+/*
+ This file is part of Zagreus.
+
+ Zagreus is a UCI chess engine
+ Copyright (C) 2023-2024  Danny Jelsma
+
+ Zagreus is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published
+ by the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Zagreus is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with Zagreus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "catch2/catch_test_macros.hpp"
+
+#include <cstring>
+#include <random>
+#include <sstream>
+
+#include "../src/bitboard.h"
+#include "../src/engine.h"
+#include "../src/movegen.h"
+#include "../src/nnue.h"
+
+static void loadRandomNetwork() {
+    constexpr int valueCount = Zagreus::NNUE_INPUT_SIZE * Zagreus::NNUE_HIDDEN_SIZE
+                               + Zagreus::NNUE_HIDDEN_SIZE + 2 * Zagreus::NNUE_HIDDEN_SIZE + 1;
+    std::mt19937 generator(12345);
+    std::uniform_int_distribution<int> distribution(-64, 64);
+    std::string data{};
+
+    for (int i = 0; i < valueCount; i++) {
+        auto value = static_cast<int16_t>(distribution(generator));
+        data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    std::istringstream stream(data);
+    REQUIRE(Zagreus::loadNetwork(stream));
+}
+
+static bool isSameAccumulator(const Zagreus::Accumulator& a, const Zagreus::Accumulator& b) {
+    return std::memcmp(a.values, b.values, sizeof(a.values)) == 0;
+}
+
+// Every move is made and unmade, after which the incrementally updated accumulator must still match
+// a full refresh of the position.
+static void checkIncrementalUpdates(Zagreus::Bitboard& bb) {
+    Zagreus::MoveList moveList{};
+    Zagreus::Accumulator initialAccumulator = bb.getAccumulator();
+
+    if (bb.getMovingColor() == Zagreus::WHITE) {
+        Zagreus::generateMoves<Zagreus::WHITE, Zagreus::NORMAL>(bb, &moveList);
+    } else {
+        Zagreus::generateMoves<Zagreus::BLACK, Zagreus::NORMAL>(bb, &moveList);
+    }
+
+    for (int i = 0; i < moveList.size; i++) {
+        Zagreus::Move move = moveList.moves[i];
+
+        bb.makeMove(move);
+        Zagreus::Bitboard refreshed = bb;
+        refreshed.refreshAccumulator();
+        REQUIRE(isSameAccumulator(bb.getAccumulator(), refreshed.getAccumulator()));
+
+        bb.unmakeMove(move);
+        REQUIRE(isSameAccumulator(bb.getAccumulator(), initialAccumulator));
+    }
+}
+
+TEST_CASE("Test NNUE accumulator updates", "[nnue]") {
+    Zagreus::ZagreusEngine engine{};
+    Zagreus::Bitboard bb{};
+
+    loadRandomNetwork();
+    Zagreus::setNnueEnabled(true);
+    REQUIRE(Zagreus::isNnueEnabled());
+
+    SECTION("Castling") {
+        bb.setFromFen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+        checkIncrementalUpdates(bb);
+    }
+
+    SECTION("Promotions") {
+        bb.setFromFen("n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1");
+        checkIncrementalUpdates(bb);
+    }
+
+    SECTION("En passant") {
+        bb.setFromFen("8/8/3p4/KPp4r/1R2Pp1k/8/6P1/8 b - e3 0 1");
+        checkIncrementalUpdates(bb);
+    }
+
+    Zagreus::setNnueEnabled(false);
+}
+
+TEST_CASE("Test NNUE evaluation symmetry", "[nnue]") {
+    Zagreus::ZagreusEngine engine{};
+    Zagreus::Bitboard white{};
+    Zagreus::Bitboard black{};
+
+    loadRandomNetwork();
+    Zagreus::setNnueEnabled(true);
+
+    // The same position with the colors flipped must evaluate the same for the side to move
+    white.setFromFen("r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4");
+    black.setFromFen("rnbqk2r/pppp1ppp/5n2/2b1p3/4P3/2N2N2/PPPP1PPP/R1BQKB1R b KQkq - 4 4");
+
+    int whiteScore = Zagreus::evaluateNnue(white.getAccumulator(), white.getMovingColor());
+    int blackScore = Zagreus::evaluateNnue(black.getAccumulator(), black.getMovingColor());
+    REQUIRE(whiteScore == blackScore);
+
+    Zagreus::setNnueEnabled(false);
+}
@@ -20,6 +20,12 @@
 
 #include "catch2/catch_test_macros.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
 #include "../src/bitboard.h"
 #include "../src/engine.h"
 
@@ -107,3 +113,56 @@ TEST_CASE("'rnbqkb1r/ppppp1pp/7n/4Pp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3' at de
     uint64_t perft = engine.doPerft(bb, bb.getMovingColor(), 5, 5);
     REQUIRE(perft == 11139762);
 }
+
+TEST_CASE("Bulk counting perft matches the regular perft", "[perft]") {
+    Zagreus::ZagreusEngine engine{};
+    Zagreus::Bitboard bb{};
+    // A small table, so entries get replaced a lot
+    engine.setEngineOption("PerftHash", "1");
+
+    SECTION("Single thread") {
+        bb.setFromFen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -");
+        REQUIRE(engine.doBulkPerft(bb, 4, false) == 4085603);
+
+        bb.setFromFen("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - -");
+        REQUIRE(engine.doBulkPerft(bb, 6, false) == 11030083);
+    }
+
+    SECTION("Multiple threads") {
+        engine.setEngineOption("Threads", "4");
+
+        bb.setFromFen("r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1");
+        REQUIRE(engine.doBulkPerft(bb, 5, false) == 15833292);
+
+        bb.setFromFen("rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8");
+        REQUIRE(engine.doBulkPerft(bb, 4, false) == 2103487);
+    }
+}
+
+// Hidden, run with the "[perft-nps]" tag. Reports the perft speed of the move generator.
+// Pseudo-legal generation, rejecting moves after makeMove: ~6.8M nps
+// Legal generation with check and pin masks: ~10.0M nps
+TEST_CASE("Perft nodes per second", "[.][perft-nps]") {
+    Zagreus::ZagreusEngine engine{};
+    Zagreus::Bitboard bb{};
+    std::vector<std::string> positions = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - -",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    };
+    uint64_t nodes = 0;
+    auto startTime = std::chrono::steady_clock::now();
+
+    for (std::string& fen : positions) {
+        bb.setFromFen(fen);
+        nodes += engine.doPerft(bb, bb.getMovingColor(), 5, 5);
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - startTime).count();
+    uint64_t nps = nodes * 1000 / std::max<int64_t>(elapsed, 1);
+
+    std::cout << nodes << " nodes " << nps << " nps" << std::endl;
+    REQUIRE(nodes > 0);
+}
@@ -0,0 +1,106 @@
+/*
+ This file is part of Zagreus.
+
+ Zagreus is a UCI chess engine
+ Copyright (C) 2023-2024  Danny Jelsma
+
+ Zagreus is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published
+ by the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Zagreus is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with Zagreus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "catch2/catch_test_macros.hpp"
+
+#include "../src/bitboard.h"
+
+static void makeMoves(Zagreus::Bitboard& bb, std::initializer_list<Zagreus::Move> moves) {
+    for (Zagreus::Move move : moves) {
+        bb.makeMove(move);
+    }
+}
+
+TEST_CASE("Test repetition detection", "[repetition]") {
+    Zagreus::Bitboard bb{};
+    bb.setFromFen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    Zagreus::Move knightsOut[] = {Zagreus::encodeMove(Zagreus::G1, Zagreus::F3),
+                                  Zagreus::encodeMove(Zagreus::G8, Zagreus::F6)};
+    Zagreus::Move knightsBack[] = {Zagreus::encodeMove(Zagreus::F3, Zagreus::G1),
+                                   Zagreus::encodeMove(Zagreus::F6, Zagreus::G8)};
+
+    SECTION("A repetition inside the search tree is a draw") {
+        makeMoves(bb, {Zagreus::encodeMove(Zagreus::E2, Zagreus::E3),
+                       Zagreus::encodeMove(Zagreus::E7, Zagreus::E6)});
+        makeMoves(bb, {knightsOut[0], knightsOut[1], knightsBack[0], knightsBack[1]});
+        REQUIRE(bb.isDraw(0));
+        // Going back to the root position is not a repetition of a position in the tree
+        REQUIRE_FALSE(bb.isDraw(2));
+    }
+
+    SECTION("A repetition of a game position needs three occurrences") {
+        makeMoves(bb, {knightsOut[0], knightsOut[1], knightsBack[0], knightsBack[1]});
+        REQUIRE_FALSE(bb.isDraw(4));
+
+        makeMoves(bb, {knightsOut[0], knightsOut[1], knightsBack[0], knightsBack[1]});
+        REQUIRE(bb.isDraw(8));
+    }
+
+    SECTION("Positions before a null move do not repeat") {
+        makeMoves(bb, {Zagreus::encodeMove(Zagreus::E2, Zagreus::E3),
+                       Zagreus::encodeMove(Zagreus::E7, Zagreus::E6)});
+        bb.makeNullMove();
+        bb.makeMove(knightsOut[1]);
+        bb.makeNullMove();
+        bb.makeMove(knightsBack[1]);
+        REQUIRE_FALSE(bb.isDraw(0));
+        REQUIRE_FALSE(bb.hasUpcomingRepetition(0));
+    }
+
+    SECTION("A null move does not reset the fifty move rule") {
+        bb.setFromFen("4k3/8/8/8/8/8/8/R3K3 w - - 5 40");
+        bb.makeNullMove();
+        REQUIRE(bb.getHalfMoveClock() == 5);
+        bb.makeMove(Zagreus::encodeMove(Zagreus::E8, Zagreus::D8));
+        REQUIRE(bb.getHalfMoveClock() == 6);
+        bb.unmakeMove(Zagreus::encodeMove(Zagreus::E8, Zagreus::D8));
+        bb.unmakeNullMove();
+        REQUIRE(bb.getHalfMoveClock() == 5);
+    }
+
+    SECTION("A move back to a position in the search tree is found") {
+        makeMoves(bb, {Zagreus::encodeMove(Zagreus::E2, Zagreus::E3),
+                       Zagreus::encodeMove(Zagreus::E7, Zagreus::E6),
+                       knightsOut[0], knightsOut[1], knightsBack[0]});
+        REQUIRE(bb.hasUpcomingRepetition(0));
+        REQUIRE_FALSE(bb.hasUpcomingRepetition(2));
+    }
+
+    SECTION("A move back is not found when the path is blocked") {
+        // The rook walks a1-b1-b4-a4, so a4-a1 would go back to the position after Kd8
+        Zagreus::Move rookWalk[] = {Zagreus::encodeMove(Zagreus::E1, Zagreus::F1),
+                                    Zagreus::encodeMove(Zagreus::E8, Zagreus::D8),
+                                    Zagreus::encodeMove(Zagreus::A1, Zagreus::B1),
+                                    Zagreus::encodeMove(Zagreus::D8, Zagreus::E8),
+                                    Zagreus::encodeMove(Zagreus::B1, Zagreus::B4),
+                                    Zagreus::encodeMove(Zagreus::E8, Zagreus::D8),
+                                    Zagreus::encodeMove(Zagreus::B4, Zagreus::A4)};
+
+        bb.setFromFen("4k3/8/8/8/8/8/8/R3K3 w - - 0 1");
+        makeMoves(bb, {rookWalk[0], rookWalk[1], rookWalk[2], rookWalk[3], rookWalk[4],
+                       rookWalk[5], rookWalk[6]});
+        REQUIRE(bb.hasUpcomingRepetition(0));
+
+        bb.setFromFen("4k3/8/8/8/8/8/P7/R3K3 w - - 0 1");
+        makeMoves(bb, {rookWalk[0], rookWalk[1], rookWalk[2], rookWalk[3], rookWalk[4],
+                       rookWalk[5], rookWalk[6]});
+        REQUIRE_FALSE(bb.hasUpcomingRepetition(0));
+    }
+}
@@ -21,12 +21,10 @@
 #include <catch2/catch_session.hpp>
 
 #include "../src/bitboard.h"
-#include "../src/magics.h"
 #include "../src/pst.h"
 
 int main(int argc, char* argv[]) {
     Zagreus::initializeBitboardConstants();
-    Zagreus::initializeMagicBitboards();
     Zagreus::initializePst();
 
     int result = Catch::Session().run(argc, argv);
@@ -0,0 +1,70 @@
+/*
+ This file is part of Zagreus.
+
+ Zagreus is a UCI chess engine
+ Copyright (C) 2023-2024  Danny Jelsma
+
+ Zagreus is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as published
+ by the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Zagreus is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with Zagreus.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "catch2/catch_test_macros.hpp"
+
+#include "../src/bitboard.h"
+#include "../src/tt.h"
+
+TEST_CASE("Test that TT entries round-trip", "[tt]") {
+    Zagreus::TranspositionTable tt{};
+    tt.setTableSize(1, 1);
+
+    uint64_t hash = 0x9D39247E33776D41ULL;
+    int ply = 7;
+    Zagreus::Move move = Zagreus::encodeMove(Zagreus::G1, Zagreus::F3);
+    Zagreus::TTEntry entry{};
+
+    SECTION("The move, score and bound are stored") {
+        tt.addPosition(hash, 5, 37, Zagreus::EXACT_NODE, move, ply);
+
+        REQUIRE(tt.getEntry(hash, entry));
+        REQUIRE(entry.bestMove == move);
+        REQUIRE(entry.score == 37);
+        REQUIRE(entry.depth == 5);
+        REQUIRE(entry.nodeType == Zagreus::EXACT_NODE);
+        REQUIRE(tt.getScore(hash, 5, -100, 100, ply) == 37);
+        // Not deep enough
+        REQUIRE(tt.getScore(hash, 6, -100, 100, ply) == INT32_MIN);
+    }
+
+    SECTION("A fail low entry only returns its score below alpha") {
+        tt.addPosition(hash, 5, -20, Zagreus::FAIL_LOW_NODE, move, ply);
+
+        REQUIRE(tt.getEntry(hash, entry));
+        REQUIRE(entry.bestMove == move);
+        REQUIRE(tt.getScore(hash, 5, -10, 100, ply) == -20);
+        REQUIRE(tt.getScore(hash, 5, -30, 100, ply) == INT32_MIN);
+    }
+
+    SECTION("Mate scores are stored relative to the node") {
+        int mateScore = MATE_SCORE - (ply + 3);
+        tt.addPosition(hash, 5, mateScore, Zagreus::EXACT_NODE, move, ply);
+
+        REQUIRE(tt.getEntry(hash, entry));
+        REQUIRE(entry.bestMove == move);
+        REQUIRE(tt.getScore(hash, 5, -100, 100, ply) == mateScore);
+        // The same position found at another ply is mated at the same distance from it
+        REQUIRE(tt.getScore(hash, 5, -100, 100, ply + 2) == mateScore - 2);
+
+        tt.addPosition(hash ^ 1, 5, -mateScore, Zagreus::EXACT_NODE, move, ply);
+        REQUIRE(tt.getScore(hash ^ 1, 5, -100, 100, ply) == -mateScore);
+    }
+}